@@ -0,0 +1,181 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file bench_fmt.c
+ * @brief Host microbenchmark: edyht_fmt serializers vs. sprintf
+ *
+ * Serializes the 1000 element test.json array once the way arrayProcess did
+ * before (sprintf(",%d") + strlen + copy per element) and once with
+ * edyht_write_int_array, both into a TCP_MSS sized buffer, and checks that
+ * the output is identical. Before that, checks that the extreme values of
+ * all edyht_fmt_* calls stay within EDYHT_FMT_MAX.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -I. bench/bench_fmt.c edyht_fmt.c -o bench_fmt && ./bench_fmt
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "edyht_fmt.h"
+
+#define BUF_LEN   1460
+#define N_VALS    1000
+#define N_RUNS    20000
+
+struct edyht_writer {
+	unsigned int len;
+	unsigned int flushes;
+	unsigned long total;
+	char buf[BUF_LEN];
+	char out[8 * N_VALS];
+};
+
+static void flush(edyht_writer_t *w){
+	memcpy(&w->out[w->total], w->buf, w->len);
+	w->total += w->len;
+	w->len = 0;
+	w->flushes++;
+}
+
+unsigned int edyht_write_space(edyht_writer_t *w){
+	return BUF_LEN - w->len;
+}
+
+char* edyht_write_reserve(edyht_writer_t *w, unsigned int len){
+	if(len > BUF_LEN - w->len) flush(w);
+	return &w->buf[w->len];
+}
+
+void edyht_write_commit(edyht_writer_t *w, unsigned int len){
+	w->len += len;
+}
+
+static void writeCopy(edyht_writer_t *w, const char *data, unsigned int len){
+	if(len > BUF_LEN - w->len) flush(w);
+	memcpy(&w->buf[w->len], data, len);
+	w->len += len;
+}
+
+static int vals[N_VALS];
+
+static void runSprintf(edyht_writer_t *w){
+	char val[20];
+	for(int pos = 0; pos < N_VALS; pos++){
+		if(pos == 0){
+			sprintf(val, "%d", vals[pos]);
+		}
+		else{
+			sprintf(val, ",%d", vals[pos]);
+		}
+		writeCopy(w, val, strlen(val));
+	}
+	flush(w);
+}
+
+static void runFmt(edyht_writer_t *w){
+	edyht_write_int_array(w, vals, N_VALS, EDYHT_FMT_JSON);
+	flush(w);
+}
+
+//Extreme values: length must match printf and stay within EDYHT_FMT_MAX
+static int checkLimits(void){
+	static const float floats[] = { -1.7e19f, 1.7e19f, -1.79e19f, 4294967296.0f, -123.456f };
+	static const int ints[] = { 0, -1, 2147483647, -2147483647 - 1 };
+	char buf[EDYHT_FMT_MAX + 8];
+	char ref[64];
+	int err = 0;
+	int len;
+	unsigned int i, d;
+
+	for(i = 0; i < sizeof(floats)/sizeof(floats[0]); i++){
+		for(d = 0; d <= 9; d++){
+			memset(buf, '#', sizeof(buf));
+			len = edyht_fmt_float(buf, floats[i], d);
+			snprintf(ref, sizeof(ref), "%.*f", (int)d, floats[i]);
+			if((len > EDYHT_FMT_MAX) || (buf[EDYHT_FMT_MAX] != '#') || (len != (int)strlen(ref))){
+				printf("ERROR: edyht_fmt_float(%g, %u) %d chars, printf %d\n", floats[i], d, len, (int)strlen(ref));
+				err = 1;
+			}
+		}
+	}
+	for(i = 0; i < sizeof(ints)/sizeof(ints[0]); i++){
+		len = edyht_fmt_int(buf, ints[i]);
+		snprintf(ref, sizeof(ref), "%d", ints[i]);
+		if((len != (int)strlen(ref)) || (memcmp(buf, ref, len) != 0)){
+			printf("ERROR: edyht_fmt_int(%d)\n", ints[i]);
+			err = 1;
+		}
+		len = edyht_fmt_fix(buf, ints[i], 9);
+		if(len > EDYHT_FMT_MAX){
+			printf("ERROR: edyht_fmt_fix(%d, 9) %d chars\n", ints[i], len);
+			err = 1;
+		}
+	}
+	return err;
+}
+
+static double bench(const char *name, void (*run)(edyht_writer_t *w), edyht_writer_t *w){
+	struct timespec t0, t1;
+	double ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for(int i = 0; i < N_RUNS; i++){
+		w->len = 0;
+		w->total = 0;
+		w->flushes = 0;
+		run(w);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / N_RUNS;
+	printf("%-10s %10.0f ns/array %6.1f ns/value %6lu bytes %3u flushes\n",
+			name, ns, ns / N_VALS, w->total, w->flushes);
+	return ns;
+}
+
+int main(void){
+	static edyht_writer_t ref, fmt;
+	double tRef, tFmt;
+
+	if(checkLimits()) return 1;
+
+	for(int pos = 0; pos < N_VALS; pos++){
+		vals[pos] = pos/2 + 1 + pos/3;
+	}
+
+	tRef = bench("sprintf", runSprintf, &ref);
+	tFmt = bench("edyht_fmt", runFmt, &fmt);
+
+	if((ref.total != fmt.total) || (memcmp(ref.out, fmt.out, ref.total) != 0)){
+		printf("ERROR: output differs\n");
+		return 1;
+	}
+	printf("speedup    %10.1fx\n", tRef / tFmt);
+	return 0;
+}
@@ -0,0 +1,446 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file bench_load.c
+ * @brief Host load generator: requests/s, latency and throughput per route
+ *
+ * Runs each route at each concurrency level for a fixed time: every
+ * client thread sends GET requests over its own persistent connection
+ * (or a new connection per request with -k) and waits for the complete
+ * response before sending the next one. Prints requests/s, p50/p99/max
+ * latency and received bytes/s; with -o the results are appended as one
+ * JSON object per line, tagged with -l, for tracking regressions.
+ *
+ * With -s the routes are event streams and are checked instead of loaded:
+ * the first event must hold all values ("full"), further events with the
+ * changes or heartbeat comments must follow within -d seconds and a new subscription
+ * must start with all values again. Exits with 1 if a check fails.
+ *
+ * Build and run on the host, e.g. against host/host_main.c:
+ *   gcc -O2 -pthread bench/bench_load.c -o bench_load
+ *   ./bench_load -p 8080 -c 1,4,8 -d 5 -l $(git rev-parse --short HEAD) \
+ *       -o load.jsonl / test.json test.dat?fmt=raw tasks.json
+ *   ./bench_load -p 8080 -s -d 3 live
+ *
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#define LEVELS_MAX   16
+#define CLIENTS_MAX  256
+#define RX_LEN       16384
+#define REQ_LEN      512
+
+static struct sockaddr_in server;
+static int keepAlive = 1;
+
+typedef struct {
+	pthread_t thread;
+	const char *route;
+	double until;                 //end of the run, s
+	unsigned long requests;
+	unsigned long errors;         //failed connections / responses, status >= 400
+	unsigned long long bytes;
+	unsigned int *lat;            //latencies in us
+	unsigned long latCount, latMax;
+	int fd;
+	size_t start, end;            //unparsed data in rx
+	char rx[RX_LEN];
+} client_t;
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int connOpen(client_t *c){
+	int on = 1;
+
+	c->fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(c->fd < 0) return -1;
+	setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	if(connect(c->fd, (struct sockaddr*)&server, sizeof(server)) != 0){
+		close(c->fd);
+		c->fd = -1;
+		return -1;
+	}
+	c->start = c->end = 0;
+	return 0;
+}
+
+static void connClose(client_t *c){
+	if(c->fd >= 0) close(c->fd);
+	c->fd = -1;
+}
+
+//Receive more data, returns bytes received, <= 0 on close / error
+static ssize_t rxFill(client_t *c){
+	ssize_t n;
+
+	if(c->start > 0){
+		memmove(c->rx, &c->rx[c->start], c->end - c->start);
+		c->end -= c->start;
+		c->start = 0;
+	}
+	if(c->end == RX_LEN) return -1; //header line too long
+	do{
+		n = recv(c->fd, &c->rx[c->end], RX_LEN - c->end, 0);
+	}while((n < 0) && (errno == EINTR));
+	if(n > 0){
+		c->end += n;
+		c->bytes += n;
+	}
+	return n;
+}
+
+//Line ending with "\r\n" starting at c->start, returns its length incl. "\r\n" or -1
+static long rxLine(client_t *c){
+	for(;;){
+		char *p = memmem(&c->rx[c->start], c->end - c->start, "\r\n", 2);
+		if(p != NULL) return p - &c->rx[c->start] + 2;
+		if(rxFill(c) <= 0) return -1;
+	}
+}
+
+//Skip n body bytes
+static int rxSkip(client_t *c, unsigned long long n){
+	while(n > 0){
+		size_t avail = c->end - c->start;
+		if(avail == 0){
+			if(rxFill(c) <= 0) return -1;
+			continue;
+		}
+		if(avail > n) avail = n;
+		c->start += avail;
+		n -= avail;
+	}
+	return 0;
+}
+
+//Read one response, returns the status code, -1 on errors, -2 if the
+//connection was closed before the response. *closing if the server closes.
+static int rxResponse(client_t *c, int *closing){
+	long len;
+	int status = -1, chunked = 0;
+	long long contentLength = -1;
+
+	*closing = !keepAlive;
+	if((c->start == c->end) && (rxFill(c) <= 0)) return -2;
+	len = rxLine(c);
+	if((len < 0) || (sscanf(&c->rx[c->start], "HTTP/1.%*d %d", &status) != 1)) return -1;
+	c->start += len;
+	for(;;){
+		const char *l;
+		len = rxLine(c);
+		if(len < 0) return -1;
+		l = &c->rx[c->start];
+		c->start += len;
+		if(len == 2) break;
+		if(strncasecmp(l, "Content-Length:", 15) == 0) contentLength = atoll(l + 15);
+		else if((strncasecmp(l, "Transfer-Encoding:", 18) == 0) && (strstr(l, "chunked") != NULL)) chunked = 1;
+		else if((strncasecmp(l, "Connection:", 11) == 0) && (strncasecmp(l + 11, " close", 6) == 0)) *closing = 1;
+	}
+	if((status == 304) || (status == 101)) return status;
+	if(chunked){
+		for(;;){
+			unsigned long long size;
+			len = rxLine(c);
+			if(len < 0) return -1;
+			size = strtoull(&c->rx[c->start], NULL, 16);
+			c->start += len;
+			if(rxSkip(c, size + 2) != 0) return -1; //data and "\r\n"
+			if(size == 0) break;
+		}
+	}
+	else if(contentLength >= 0){
+		if(rxSkip(c, contentLength) != 0) return -1;
+	}
+	else{
+		while(rxFill(c) > 0) c->start = c->end; //body ends with the connection
+		*closing = 1;
+	}
+	return status;
+}
+
+static void latAdd(client_t *c, unsigned int us){
+	if(c->latCount == c->latMax){
+		c->latMax = c->latMax ? 2 * c->latMax : 4096;
+		c->lat = realloc(c->lat, c->latMax * sizeof(c->lat[0]));
+		if(c->lat == NULL) exit(1);
+	}
+	c->lat[c->latCount++] = us;
+}
+
+//Next event or comment of an event stream, ends with an empty line. Returns
+//its length, -1 on close / errors, -2 if nothing arrived within SO_RCVTIMEO.
+static long sseEvent(client_t *c){
+	for(;;){
+		char *p = memmem(&c->rx[c->start], c->end - c->start, "\n\n", 2);
+		ssize_t n;
+		if(p != NULL) return p - &c->rx[c->start] + 2;
+		n = rxFill(c);
+		if((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) return -2;
+		if(n <= 0) return -1;
+	}
+}
+
+//Subscribe to an event stream, returns the id of the first event, which
+//must hold all values, or -1
+static long sseOpen(client_t *c, const char *route){
+	struct timeval tv = { 1, 0 };
+	char req[REQ_LEN];
+	int reqLen = snprintf(req, sizeof(req), "GET /%s HTTP/1.1\r\nHost: %s\r\nAccept: text/event-stream\r\n\r\n",
+			route, inet_ntoa(server.sin_addr));
+	int status = -1, events = 0;
+	long len, id = -1;
+
+	if(connOpen(c) != 0) return -1;
+	setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	if(send(c->fd, req, reqLen, MSG_NOSIGNAL) != reqLen) return -1;
+	len = rxLine(c);
+	if((len < 0) || (sscanf(&c->rx[c->start], "HTTP/1.%*d %d", &status) != 1) || (status != 200)) return -1;
+	c->start += len;
+	for(;;){
+		const char *l;
+		len = rxLine(c);
+		if(len < 0) return -1;
+		l = &c->rx[c->start];
+		c->start += len;
+		if(len == 2) break;
+		if((strncasecmp(l, "Content-type:", 13) == 0) && (memmem(l, len, "text/event-stream", 17) != NULL)) events = 1;
+	}
+	if(!events) return -1;
+	len = sseEvent(c);
+	if((len < 0) || (memmem(&c->rx[c->start], len, "event: full\n", 12) == NULL)) return -1;
+	sscanf(&c->rx[c->start], "id: %ld", &id);
+	c->start += len;
+	return id;
+}
+
+//-s: check an event stream route for the given time
+static int sseCheck(const char *route, double seconds){
+	client_t *c = calloc(1, sizeof(*c));
+	unsigned int updates = 0, beats = 0;
+	long first, again, len;
+	double t0;
+	int ok;
+
+	if(c == NULL) exit(1);
+	first = sseOpen(c, route);
+	t0 = now();
+	while((first >= 0) && (now() - t0 < seconds)){
+		len = sseEvent(c);
+		if(len == -2) continue;
+		if(len < 0) break;
+		if(c->rx[c->start] == ':') beats++;
+		else updates++; //"delta", or "full" if most values changed
+		c->start += len;
+	}
+	connClose(c);
+	again = sseOpen(c, route);
+	connClose(c);
+	free(c);
+
+	ok = (first >= 0) && (again >= first) && (updates + beats > 0);
+	printf("%-24s full id %ld, %u updates, %u heartbeats in %.1f s, resubscribed: full id %ld  %s\n",
+			route, first, updates, beats, seconds, again, ok ? "OK" : "FAILED");
+	return ok;
+}
+
+static void* clientRun(void *arg){
+	client_t *c = arg;
+	char req[REQ_LEN];
+	int reqLen = snprintf(req, sizeof(req), "GET /%s HTTP/1.1\r\nHost: %s\r\n%s\r\n", c->route,
+			inet_ntoa(server.sin_addr), keepAlive ? "" : "Connection: close\r\n");
+
+	c->fd = -1;
+	while(now() < c->until){
+		double t0 = now();
+		int status, closing, reused = (c->fd >= 0);
+
+		if((c->fd < 0) && (connOpen(c) != 0)){
+			c->errors++;
+			usleep(1000);
+			continue;
+		}
+		if(send(c->fd, req, reqLen, MSG_NOSIGNAL) != reqLen){
+			c->errors++;
+			connClose(c);
+			continue;
+		}
+		status = rxResponse(c, &closing);
+		if((status == -2) && reused){
+			//persistent connection closed by the server meanwhile, retry
+			connClose(c);
+			continue;
+		}
+		if(status < 0){
+			c->errors++;
+			connClose(c);
+			continue;
+		}
+		if(status >= 400) c->errors++;
+		c->requests++;
+		latAdd(c, (unsigned int)((now() - t0) * 1e6));
+		if(closing) connClose(c);
+	}
+	connClose(c);
+	return NULL;
+}
+
+static int latCompare(const void *a, const void *b){
+	unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+	return (x > y) - (x < y);
+}
+
+static void run(const char *route, int clients, double seconds, const char *label, FILE *out){
+	static client_t c[CLIENTS_MAX];
+	unsigned long requests = 0, errors = 0, n = 0;
+	unsigned long long bytes = 0;
+	unsigned int *lat, p50 = 0, p99 = 0, max = 0;
+	double t0, t;
+	int i;
+
+	t0 = now();
+	for(i = 0; i < clients; i++){
+		memset(&c[i], 0, offsetof(client_t, rx));
+		c[i].route = route;
+		c[i].until = t0 + seconds;
+		pthread_create(&c[i].thread, NULL, clientRun, &c[i]);
+	}
+	for(i = 0; i < clients; i++){
+		pthread_join(c[i].thread, NULL);
+		requests += c[i].requests;
+		errors += c[i].errors;
+		bytes += c[i].bytes;
+	}
+	t = now() - t0;
+
+	lat = malloc((requests + 1) * sizeof(lat[0]));
+	if(lat == NULL) exit(1);
+	for(i = 0; i < clients; i++){
+		memcpy(&lat[n], c[i].lat, c[i].latCount * sizeof(lat[0]));
+		n += c[i].latCount;
+		free(c[i].lat);
+	}
+	if(n > 0){
+		qsort(lat, n, sizeof(lat[0]), latCompare);
+		p50 = lat[n / 2];
+		p99 = lat[(n * 99) / 100];
+		max = lat[n - 1];
+	}
+	free(lat);
+
+	printf("/%-23s %4d %10.0f %8u %8u %8u %12.0f %8lu\n", route, clients, requests / t, p50, p99, max, bytes / t, errors);
+	if(out != NULL){
+		fprintf(out, "{\"label\":\"%s\",\"route\":\"/%s\",\"clients\":%d,\"keepalive\":%d,\"seconds\":%.3f,"
+				"\"requests\":%lu,\"errors\":%lu,\"rps\":%.1f,\"p50_us\":%u,\"p99_us\":%u,\"max_us\":%u,"
+				"\"bytes_per_s\":%.0f}\n",
+				label, route, clients, keepAlive, t, requests, errors, requests / t, p50, p99, max, bytes / t);
+		fflush(out);
+	}
+}
+
+static void usage(void){
+	fprintf(stderr,
+			"usage: bench_load [-a addr] [-p port] [-c clients,...] [-d seconds] [-k] [-s] [-l label] [-o file] route...\n"
+			"  -k  new connection per request (default: persistent connections)\n"
+			"  -s  check event stream routes instead of load\n"
+			"  -o  append results as JSON lines\n");
+	exit(2);
+}
+
+int main(int argc, char **argv){
+	const char *addr = "127.0.0.1", *label = "", *outName = NULL;
+	int port = 80, levels[LEVELS_MAX] = { 1, 4, 16 }, nLevels = 3;
+	double seconds = 5;
+	FILE *out = NULL;
+	int sse = 0, failed = 0;
+	int opt, i, r;
+
+	while((opt = getopt(argc, argv, "a:p:c:d:ksl:o:")) != -1){
+		switch(opt){
+		case 'a': addr = optarg; break;
+		case 'p': port = atoi(optarg); break;
+		case 'd': seconds = atof(optarg); break;
+		case 'k': keepAlive = 0; break;
+		case 's': sse = 1; break;
+		case 'l': label = optarg; break;
+		case 'o': outName = optarg; break;
+		case 'c':
+			nLevels = 0;
+			for(char *s = strtok(optarg, ","); (s != NULL) && (nLevels < LEVELS_MAX); s = strtok(NULL, ",")){
+				levels[nLevels] = atoi(s);
+				if((levels[nLevels] < 1) || (levels[nLevels] > CLIENTS_MAX)) usage();
+				nLevels++;
+			}
+			break;
+		default: usage();
+		}
+	}
+	if((optind == argc) || (nLevels == 0)) usage();
+
+	memset(&server, 0, sizeof(server));
+	server.sin_family = AF_INET;
+	server.sin_port = htons(port);
+	if(inet_pton(AF_INET, addr, &server.sin_addr) != 1) usage();
+	if(sse){
+		for(r = optind; r < argc; r++){
+			if(!sseCheck((argv[r][0] == '/') ? argv[r] + 1 : argv[r], seconds)) failed = 1;
+		}
+		return failed;
+	}
+	if(outName != NULL){
+		out = fopen(outName, "a");
+		if(out == NULL){
+			perror(outName);
+			return 1;
+		}
+	}
+
+	printf("%-24s %4s %10s %8s %8s %8s %12s %8s\n", "route", "conc", "req/s", "p50 us", "p99 us", "max us", "bytes/s", "errors");
+	for(r = optind; r < argc; r++){
+		const char *route = (argv[r][0] == '/') ? argv[r] + 1 : argv[r];
+		for(i = 0; i < nLevels; i++) run(route, levels[i], seconds, label, out);
+	}
+	if(out != NULL) fclose(out);
+	return 0;
+}
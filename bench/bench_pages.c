@@ -0,0 +1,366 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file bench_pages.c
+ * @brief Microbenchmark: request path from parser to the last write
+ *
+ * Feeds complete requests through edyht_parse and the page dispatcher of
+ * edyht.c (included here to reach its static functions) with netconn_write
+ * replaced by a capture-only fake that counts calls and bytes and keeps the
+ * first bytes of the response to check the status. Covers the parser, a
+ * static asset, the query echo of testform.htm (queryShow), the test array
+ * as JSON/CSV stream and as CBOR/raw body, and the task pages, cached and
+ * with the cache invalidated before every request.
+ *
+ * Prints ns/request (best of 5 rounds), write calls/request and bytes/write per case and
+ * compares them with a baseline file (-b, default bench/bench_pages.baseline
+ * if present). A case regresses if it is more than -t percent (default 10)
+ * slower, needs more writes or sends less bytes per write; the exit status
+ * is 1 then. -w writes the results as new baseline. ns depend on the
+ * machine, record a baseline of the parent commit before comparing; write
+ * counts do not, except for the task pages.
+ *
+ * Build and run on the host from the repository root (host/ shim, the
+ * server itself is started on an ephemeral port and stays idle):
+ *   ./mkhtdocs.sh
+ *   gcc -O2 -pthread -Ihost/include -I. bench/bench_pages.c host/host_port.c \
+ *       edyht_[a-z]*.c -lm -o bench_pages && ./bench_pages
+ *
+ * On Cortex-M3/4/7/33, build it instead of edyht.c into the firmware and
+ * call bench_pages_run() from a task after the network is up: times are
+ * taken from the DWT cycle counter, cycles/request are printed as well and
+ * ns are based on configCPU_CLOCK_HZ. No baseline file there.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+#define BENCH_DWT 1
+#else
+#define BENCH_DWT 0
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if !BENCH_DWT && !defined(EDYHT_PORT)
+#define EDYHT_PORT 0
+#endif
+
+#include "lwip/api.h"
+
+static err_t captureWrite(struct netconn *conn, const void *data, size_t size, u8_t flags);
+
+//All output of edyht.c goes through connWrite -> netconn_write
+#undef netconn_write
+#define netconn_write(conn, data, size, flags)  captureWrite(conn, data, size, flags)
+
+#include "edyht.c"
+
+#if EDYHT_RAW_API
+#error "bench_pages measures the netconn backend"
+#endif
+
+#define BENCH_CASES     16
+#define BENCH_NAME_LEN  24
+#define BENCH_ROUNDS    5
+
+static struct {
+	unsigned long writes;
+	unsigned long bytes;
+	unsigned int headLen;
+	char head[16];               //start of the response, for the status check
+} cap;
+
+static err_t captureWrite(struct netconn *conn, const void *data, size_t size, u8_t flags){
+	LWIP_UNUSED_ARG(conn);
+	LWIP_UNUSED_ARG(flags);
+	if(cap.headLen < sizeof(cap.head)){
+		unsigned int n = sizeof(cap.head) - cap.headLen;
+		if(n > size) n = size;
+		memcpy(&cap.head[cap.headLen], data, n);
+		cap.headLen += n;
+	}
+	cap.writes++;
+	cap.bytes += size;
+	return ERR_OK;
+}
+
+#define REQ_HEADERS \
+		"Host: 192.168.0.10\r\n" \
+		"User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:120.0) Gecko/20100101 Firefox/120.0\r\n" \
+		"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*" "/" "*;q=0.8\r\n" \
+		"Accept-Language: de,en-US;q=0.7,en;q=0.3\r\n" \
+		"Accept-Encoding: gzip, deflate\r\n" \
+		"Connection: keep-alive\r\n" \
+		"\r\n"
+
+typedef struct {
+	const char *name;
+	const char *request;
+	const char *invalidate;      //route whose cache entry is dropped before each request
+	u8_t parseOnly;
+} benchCase_t;
+
+static const benchCase_t cases[] = {
+		{ "parse",          "GET /testform.htm?name=edyht&value=12.5&unit=V HTTP/1.1\r\n" REQ_HEADERS, NULL, 1 },
+		{ "index",          "GET / HTTP/1.1\r\n" REQ_HEADERS, NULL, 0 },
+		{ "testform",       "GET /testform.htm?name=edyht&value=12.5&unit=V HTTP/1.1\r\n" REQ_HEADERS, NULL, 0 },
+		{ "test.json",      "GET /test.json HTTP/1.1\r\n" REQ_HEADERS, NULL, 0 },
+		{ "test.csv",       "GET /test.csv HTTP/1.1\r\n" REQ_HEADERS, NULL, 0 },
+		{ "test.dat-cbor",  "GET /test.dat?fmt=cbor HTTP/1.1\r\n" REQ_HEADERS, NULL, 0 },
+		{ "test.dat-raw",   "GET /test.dat?fmt=raw HTTP/1.1\r\n" REQ_HEADERS, NULL, 0 },
+		{ "tasks.json",     "GET /tasks.json HTTP/1.1\r\n" REQ_HEADERS, NULL, 0 },
+		{ "tasks.json-nc",  "GET /tasks.json HTTP/1.1\r\n" REQ_HEADERS, "tasks.json", 0 },
+		{ "tasks.htm-nc",   "GET /tasks.htm HTTP/1.1\r\n" REQ_HEADERS, "tasks.htm", 0 },
+};
+
+typedef struct {
+	char name[BENCH_NAME_LEN];
+	double ns;
+	double writes;               //per request
+	double bytesPerWrite;
+} benchResult_t;
+
+static httpCtx_t benchCtx;
+static struct netconn benchConn;
+
+#if BENCH_DWT
+#define DWT_CTRL    (*(volatile u32_t*)0xE0001000)
+#define DWT_CYCCNT  (*(volatile u32_t*)0xE0001004)
+#define DEMCR       (*(volatile u32_t*)0xE000EDFC)
+
+typedef u32_t benchTime_t;
+
+static void clockInit(void){
+	DEMCR |= (1UL << 24);        //TRCENA
+	DWT_CYCCNT = 0;
+	DWT_CTRL |= 1;               //CYCCNTENA
+}
+static inline benchTime_t clockNow(void){
+	return DWT_CYCCNT;
+}
+static inline double clockNs(benchTime_t t0, benchTime_t t1){
+	return (u32_t)(t1 - t0) * (1e9 / configCPU_CLOCK_HZ);
+}
+#else
+typedef struct timespec benchTime_t;
+
+static void clockInit(void){
+}
+static inline benchTime_t clockNow(void){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t;
+}
+static inline double clockNs(benchTime_t t0, benchTime_t t1){
+	return (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+}
+#endif
+
+//One request from the first byte to the last write, returns 0 on error
+static int runRequest(const benchCase_t *c){
+	unsigned int used;
+	unsigned int len = strlen(c->request);
+
+	edyht_parse_init(&benchCtx.parse);
+	if(edyht_parse(&benchCtx.parse, c->request, len, &used) != CHARPROC_FINISHED) return 0;
+	if(c->parseOnly) return 1;
+	if(c->invalidate != NULL) edyht_invalidate(c->invalidate);
+	return webpageProcess(&benchCtx.parse, &benchCtx.w, &benchConn, benchCtx.parse.keepAlive,
+			&benchCtx.stream, &benchCtx.ws, &benchCtx.body);
+}
+
+//Best of BENCH_ROUNDS rounds of ms / BENCH_ROUNDS each, against noise of other tasks
+static int runCase(const benchCase_t *c, unsigned int ms, benchResult_t *r){
+	unsigned long n = 0;
+	double best = 0;
+	int round;
+
+	//warm up and check the response
+	memset(&cap, 0, sizeof(cap));
+	if(!runRequest(c)) return 0;
+	if(!c->parseOnly && (memcmp(cap.head, "HTTP/1.1 200 ", 13) != 0)) return 0;
+
+	memset(&cap, 0, sizeof(cap));
+	for(round = 0; round < BENCH_ROUNDS; round++){
+		unsigned long nRound = 0, batch = 16;
+		double ns = 0;
+
+		while(ns < ms * (1e6 / BENCH_ROUNDS)){
+			benchTime_t t0, t1;
+			unsigned long i;
+
+			t0 = clockNow();
+			for(i = 0; i < batch; i++){
+				runRequest(c);
+			}
+			t1 = clockNow();
+			ns += clockNs(t0, t1);
+			nRound += batch;
+			if(batch < 1024) batch *= 2;
+		}
+		if((round == 0) || (ns / nRound < best)) best = ns / nRound;
+		n += nRound;
+	}
+
+	snprintf(r->name, sizeof(r->name), "%s", c->name);
+	r->ns = best;
+	r->writes = (double)cap.writes / n;
+	r->bytesPerWrite = cap.writes ? (double)cap.bytes / cap.writes : 0;
+	return 1;
+}
+
+#if !BENCH_DWT
+static unsigned int baselineRead(const char *path, benchResult_t *base){
+	FILE *f = fopen(path, "r");
+	char line[128];
+	unsigned int n = 0;
+
+	if(f == NULL) return 0;
+	while((n < BENCH_CASES) && (fgets(line, sizeof(line), f) != NULL)){
+		if(line[0] == '#') continue;
+		if(sscanf(line, "%23s %lf %lf %lf", base[n].name, &base[n].ns,
+				&base[n].writes, &base[n].bytesPerWrite) == 4) n++;
+	}
+	fclose(f);
+	return n;
+}
+
+static int baselineWrite(const char *path, const benchResult_t *res, unsigned int n){
+	FILE *f = fopen(path, "w");
+	unsigned int i;
+
+	if(f == NULL) return 0;
+	fprintf(f, "# bench_pages baseline: case ns/request writes/request bytes/write\n");
+	for(i = 0; i < n; i++){
+		fprintf(f, "%-16s %10.0f %8.2f %8.1f\n", res[i].name, res[i].ns, res[i].writes, res[i].bytesPerWrite);
+	}
+	fclose(f);
+	return 1;
+}
+
+static const benchResult_t* baselineFind(const benchResult_t *base, unsigned int n, const char *name){
+	unsigned int i;
+	for(i = 0; i < n; i++){
+		if(strcmp(base[i].name, name) == 0) return &base[i];
+	}
+	return NULL;
+}
+#endif
+
+//Runs all cases, returns the number of regressions or failed cases
+static int benchPages(unsigned int ms, double tolerance, const char *basePath, const char *outPath){
+	static benchResult_t res[BENCH_CASES];
+	unsigned int i, nBase = 0;
+	int bad = 0;
+#if !BENCH_DWT
+	static benchResult_t base[BENCH_CASES];
+	if(basePath != NULL) nBase = baselineRead(basePath, base);
+#else
+	LWIP_UNUSED_ARG(basePath);
+	LWIP_UNUSED_ARG(outPath);
+	LWIP_UNUSED_ARG(tolerance);
+#endif
+
+	clockInit();
+	printf("%-16s %10s %8s %8s", "case", "ns/req", "wr/req", "B/wr");
+#if BENCH_DWT
+	printf(" %10s", "cyc/req");
+#endif
+	printf("%s\n", nBase ? "   vs. baseline" : "");
+
+	for(i = 0; i < sizeof(cases)/sizeof(cases[0]); i++){
+		benchResult_t *r = &res[i];
+
+		if(!runCase(&cases[i], ms, r)){
+			printf("%-16s ERROR: request failed\n", cases[i].name);
+			snprintf(r->name, sizeof(r->name), "%s", cases[i].name);
+			bad++;
+			continue;
+		}
+		printf("%-16s %10.0f %8.2f %8.1f", r->name, r->ns, r->writes, r->bytesPerWrite);
+#if BENCH_DWT
+		printf(" %10.0f", r->ns * (configCPU_CLOCK_HZ / 1e9));
+#else
+		const benchResult_t *b = baselineFind(base, nBase, r->name);
+		if(b != NULL){
+			int slower = r->ns > b->ns * (1 + tolerance);
+			int moreWrites = r->writes > b->writes + 0.005;
+			int smallerWrites = r->bytesPerWrite < b->bytesPerWrite * (1 - tolerance);
+
+			printf("   %+6.1f%% %+6.2f wr %+7.1f B/wr%s", (r->ns / b->ns - 1) * 100,
+					r->writes - b->writes, r->bytesPerWrite - b->bytesPerWrite,
+					(slower || moreWrites || smallerWrites) ? "  REGRESSION" : "");
+			bad += slower || moreWrites || smallerWrites;
+		}
+#endif
+		printf("\n");
+	}
+
+#if !BENCH_DWT
+	if((outPath != NULL) && !baselineWrite(outPath, res, i)){
+		printf("ERROR: cannot write %s\n", outPath);
+		bad++;
+	}
+#endif
+	return bad;
+}
+
+#if BENCH_DWT
+//Call from a task once the network interface is up
+void bench_pages_run(void){
+	edyht_init();
+	benchPages(200, 0, NULL, NULL);
+}
+#else
+static void usage(void){
+	printf("usage: bench_pages [-m ms per case] [-t tolerance %%] [-b baseline] [-w new baseline]\n");
+}
+
+int main(int argc, char **argv){
+	const char *basePath = "bench/bench_pages.baseline";
+	const char *outPath = NULL;
+	unsigned int ms = 200;
+	double tolerance = 0.10;
+	int opt;
+
+	while((opt = getopt(argc, argv, "m:t:b:w:h")) != -1){
+		switch(opt){
+		case 'm': ms = atoi(optarg); break;
+		case 't': tolerance = atof(optarg) / 100; break;
+		case 'b': basePath = optarg; break;
+		case 'w': outPath = optarg; break;
+		default: usage(); return 2;
+		}
+	}
+
+	edyht_init();
+	return benchPages(ms, tolerance, basePath, outPath) ? 1 : 0;
+}
+#endif
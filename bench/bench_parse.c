@@ -0,0 +1,279 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file bench_parse.c
+ * @brief Host microbenchmark: request parser throughput
+ *
+ * Parses a typical browser request (request line with query and ~400 bytes
+ * of headers) with the former byte-by-byte charProcess state machine and
+ * with edyht_parse, once as a single segment and once split into 64 byte
+ * segments, and prints bytes per cycle. Cycles are read with rdtsc on x86
+ * (reference cycles of the TSC), otherwise only ns are printed.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -I. bench/bench_parse.c edyht_parse.c -o bench_parse && ./bench_parse
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#include "edyht_parse.h"
+
+#define N_RUNS    200000
+
+static const char request[] =
+		"GET /testform.htm?name=edyht&value=12.5&unit=V HTTP/1.1\r\n"
+		"Host: 192.168.0.10\r\n"
+		"User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:120.0) Gecko/20100101 Firefox/120.0\r\n"
+		"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+		"Accept-Language: de,en-US;q=0.7,en;q=0.3\r\n"
+		"Accept-Encoding: gzip, deflate\r\n"
+		"Connection: keep-alive\r\n"
+		"Referer: http://192.168.0.10/testform.htm\r\n"
+		"Upgrade-Insecure-Requests: 1\r\n"
+		"If-None-Match: \"5d8c72a5\"\r\n"
+		"Cache-Control: max-age=0\r\n"
+		"\r\n";
+
+/* Former parser, byte by byte (request line and Connection header only) */
+
+#define ENTRY_LEN   16
+#define LIST_LEN    10
+
+typedef struct {
+	char name[ENTRY_LEN+1];
+	char value[ENTRY_LEN+1];
+} nameVal_t;
+
+typedef enum {
+	urlState_GET, urlState_filename, urlState_queryName, urlState_queryVal,
+	urlState_version, urlState_headerName, urlState_headerValue,
+} urlState_t;
+
+typedef struct {
+	urlState_t urlState;
+	int cntChar;
+	int cntElements;
+	char filename[ENTRY_LEN+1];
+	uint32_t filenameHash;
+	nameVal_t queryList[LIST_LEN];
+	uint8_t http11;
+	uint8_t keepAlive;
+	int hdrConnection;
+	char hdrBuf[ENTRY_LEN+1];
+} charProc_t;
+
+static void charProcessInit(charProc_t *p){
+	p->cntChar = 0;
+	p->filenameHash = FNV_OFFSET;
+	p->cntElements = 0;
+	p->http11 = 0;
+	p->keepAlive = 0;
+	p->urlState = urlState_GET;
+}
+
+static int isAlnum(char c){
+	return ((c >= '0') && (c <= '9')) || ((c >= 'A') && (c <= 'Z')) || ((c >= 'a') && (c <= 'z'));
+}
+
+static int charProcess(charProc_t *p, char inChar){
+	const char* getStr = "GET /";
+	const char* verStr = "HTTP/1.";
+	int len;
+
+	if(((inChar >= 0x20) && (inChar <= 0x7e)) || (inChar == '\n'))
+		switch(p->urlState){
+		case urlState_GET:
+			if(inChar != getStr[p->cntChar]) return CHARPROC_ERR_REQUEST;
+			if(++p->cntChar == 5){ p->cntChar = 0; p->urlState = urlState_filename; }
+			break;
+		case urlState_filename:
+			if((inChar == ' ') || (inChar == '?')){
+				p->filename[p->cntChar] = '\0';
+				p->cntChar = 0;
+				p->urlState = (inChar == ' ') ? urlState_version : urlState_queryName;
+				break;
+			}
+			if(p->cntChar >= ENTRY_LEN) return CHARPROC_ERR_OWFL;
+			if(!isAlnum(inChar) && (inChar != '.')) return CHARPROC_ERR_WRONGCHAR;
+			p->filename[p->cntChar++] = inChar;
+			p->filenameHash = hashStep(p->filenameHash, inChar);
+			break;
+		case urlState_queryName:
+			if(p->cntElements >= LIST_LEN) return CHARPROC_ERR_OWFL;
+			if(inChar == '='){
+				p->queryList[p->cntElements].name[p->cntChar] = '\0';
+				p->cntChar = 0;
+				p->urlState = urlState_queryVal;
+				break;
+			}
+			if(p->cntChar >= ENTRY_LEN) return CHARPROC_ERR_OWFL;
+			if(!isAlnum(inChar) && (inChar != '.') && (inChar != '_')) return CHARPROC_ERR_WRONGCHAR;
+			p->queryList[p->cntElements].name[p->cntChar++] = inChar;
+			break;
+		case urlState_queryVal:
+			if((inChar == ' ') || (inChar == '&')){
+				p->queryList[p->cntElements].value[p->cntChar] = '\0';
+				p->cntElements++;
+				p->cntChar = 0;
+				p->urlState = (inChar == ' ') ? urlState_version : urlState_queryName;
+				break;
+			}
+			if(p->cntChar >= ENTRY_LEN) return CHARPROC_ERR_OWFL;
+			if(inChar == '+') inChar = ' ';
+			else if(!isAlnum(inChar) && (inChar != '.') && (inChar != '-')) return CHARPROC_ERR_WRONGCHAR;
+			p->queryList[p->cntElements].value[p->cntChar++] = inChar;
+			break;
+		case urlState_version:
+			if(p->cntChar < 7){
+				if(inChar != verStr[p->cntChar]) return CHARPROC_ERR_REQUEST;
+				p->cntChar++;
+				break;
+			}
+			if(p->cntChar == 7){
+				if((inChar < '0') || (inChar > '9')) return CHARPROC_ERR_REQUEST;
+				p->http11 = (inChar >= '1');
+				p->keepAlive = p->http11;
+				p->cntChar++;
+				break;
+			}
+			if(inChar != '\n') return CHARPROC_ERR_REQUEST;
+			p->cntChar = 0;
+			p->urlState = urlState_headerName;
+			break;
+		case urlState_headerName:
+			if(inChar == '\n') return (p->cntChar == 0) ? CHARPROC_FINISHED : CHARPROC_ERR_REQUEST;
+			if(inChar == ':'){
+				len = (p->cntChar < ENTRY_LEN) ? p->cntChar : ENTRY_LEN;
+				p->hdrBuf[len] = '\0';
+				p->hdrConnection = (strcmp(p->hdrBuf, "connection") == 0);
+				p->cntChar = 0;
+				p->urlState = urlState_headerValue;
+				break;
+			}
+			if(p->cntChar < ENTRY_LEN) p->hdrBuf[p->cntChar] = tolower((unsigned char)inChar);
+			p->cntChar++;
+			break;
+		case urlState_headerValue:
+			if(inChar == '\n'){
+				len = (p->cntChar < ENTRY_LEN) ? p->cntChar : ENTRY_LEN;
+				p->hdrBuf[len] = '\0';
+				if(p->hdrConnection && (strcmp(p->hdrBuf, "close") == 0)) p->keepAlive = 0;
+				p->cntChar = 0;
+				p->urlState = urlState_headerName;
+				break;
+			}
+			if((inChar == ' ') && (p->cntChar == 0)) break;
+			if(p->cntChar < ENTRY_LEN) p->hdrBuf[p->cntChar] = tolower((unsigned char)inChar);
+			p->cntChar++;
+			break;
+		}
+	return CHARPROC_OK;
+}
+
+static int runCharProcess(unsigned int segLen){
+	static charProc_t p;
+	unsigned int i;
+	int ret = CHARPROC_OK;
+
+	(void)segLen; //byte by byte anyway
+	charProcessInit(&p);
+	for(i = 0; (i < sizeof(request) - 1) && (ret == CHARPROC_OK); i++){
+		ret = charProcess(&p, request[i]);
+	}
+	return ret;
+}
+
+static int runParse(unsigned int segLen){
+	static edyht_req_t p;
+	unsigned int pos = 0;
+	int ret = CHARPROC_OK;
+
+	edyht_parse_init(&p);
+	while((pos < sizeof(request) - 1) && (ret == CHARPROC_OK)){
+		unsigned int n = sizeof(request) - 1 - pos;
+		unsigned int used;
+		if(n > segLen) n = segLen;
+		ret = edyht_parse(&p, &request[pos], n, &used);
+		pos += used;
+	}
+	return ret;
+}
+
+static void bench(const char *name, int (*run)(unsigned int segLen), unsigned int segLen){
+	struct timespec t0, t1;
+	unsigned long long c0 = 0, c1 = 0;
+	double ns;
+	int ret = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+#if HAVE_TSC
+	c0 = __rdtsc();
+#endif
+	for(int i = 0; i < N_RUNS; i++){
+		ret |= run(segLen);
+	}
+#if HAVE_TSC
+	c1 = __rdtsc();
+#endif
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / N_RUNS;
+	printf("%-12s seg %4u %8.0f ns/request %6.2f bytes/ns", name, segLen, ns, (sizeof(request) - 1) / ns);
+	if(HAVE_TSC){
+		printf(" %6.2f bytes/cycle", (double)(sizeof(request) - 1) * N_RUNS / (c1 - c0));
+	}
+	printf("%s\n", (ret == CHARPROC_FINISHED) ? "" : "  ERROR: not finished");
+}
+
+int main(void){
+	static edyht_req_t p;
+	unsigned int used;
+
+	edyht_parse_init(&p);
+	if((edyht_parse(&p, request, sizeof(request) - 1, &used) != CHARPROC_FINISHED)
+			|| (used != sizeof(request) - 1) || (strcmp(p.path, "testform.htm") != 0)
+			|| (p.queryCount != 3) || (p.hdr[EDYHT_HDR_IF_NONE_MATCH] == NULL)){
+		printf("ERROR: request not parsed\n");
+		return 1;
+	}
+
+	printf("request: %u bytes\n", (unsigned int)(sizeof(request) - 1));
+	bench("charProcess", runCharProcess, 1);
+	bench("edyht_parse", runParse, sizeof(request));
+	bench("edyht_parse", runParse, 64);
+	return 0;
+}
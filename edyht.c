@@ -1,650 +1,2729 @@
-/*
-  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
-  All rights reserved.
-
-  Redistribution and use in source and binary forms, with or without
-  modification, are permitted provided that the following conditions are met:
-
-  1. Redistributions of source code must retain the above copyright notice, this
-     list of conditions and the following disclaimer.
-  2. Redistributions in binary form must reproduce the above copyright notice,
-     this list of conditions and the following disclaimer in the documentation
-     and/or other materials provided with the distribution.
-
-  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
-  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
-  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
-  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
-  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
-  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
-  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
-  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
-  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
- */
-
-/**
- * @file edyht.c
- * @author Fabian Mink
- * @date 2017-07-25
- * @brief edyht - Embedded DYnamic Http server
- * @copyright BSD 2-Clause License
- *
- * Embedded DYnamic Http server for use with the lwIP TCP/IP stack.
- * Partially based on the httpserver-netconn example of lwIP contribution package
- *
- */
-
-#include <time.h>
-#include <string.h>
-#include <stdlib.h>
-#include <math.h>
-
-#include "lwip/opt.h"
-#include "lwip/arch.h"
-#include "lwip/api.h"
-#include "lwip/stats.h"
-#include "edyht.h"
-#include "FreeRTOS.h"
-#include "task.h"
-
-
-//Generate file.*i by "xxd -i infile.* outfile.*i"
-#include "htdocs/index.htmi"
-#include "htdocs/err404.htmi"
-#include "htdocs/credits.htmi"
-#include "htdocs/testform_begin.htmi"
-#include "htdocs/testform_end.htmi"
-#include "htdocs/tasks_begin.htmi"
-#include "htdocs/tasks_end.htmi"
-#include "htdocs/lwip_begin.htmi"
-#include "htdocs/lwip_end.htmi"
-
-static void page_FreeRTOS_Tasks(struct netconn *conn);
-//static void page_LwIP_Info(struct netconn *conn);
-
-#define EDYHT_PRIO    ( tskIDLE_PRIORITY + 3 )
-
-/* HTTP/1.0 200 OK */
-static const unsigned char http_200ok[] = {
-		0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x30, 0x20, 0x32, 0x30, 0x30,
-		0x20, 0x4f, 0x4b, 0x0d, 0x0a
-};
-static const unsigned int http_200ok_len = 17;
-
-/* HTTP/1.0 202 Accepted */
-static const unsigned char http_202acc[] = {
-		0x48,0x54,0x54,0x50,0x2f,0x31,0x2e,0x30,0x20,0x32,0x30,0x32,0x20,0x41,
-		0x63,0x63,0x65,0x70,0x74,0x65,0x64,0x0d,0x0a
-};
-static const unsigned int http_202acc_len = 23;
-
-/* HTTP/1.0 400 Bad Request */
-static const unsigned char http_400bad[] = {
-		0x48,0x54,0x54,0x50,0x2f,0x31,0x2e,0x30,0x20,0x34,0x30,0x30,0x20,0x42,
-		0x61,0x64,0x20,0x52,0x65,0x71,0x75,0x65,0x73,0x74,0x0d,0x0a
-};
-static const unsigned int http_400bad_len = 26;
-
-/* HTTP/1.0 404 File not found */
-static const unsigned char http_404fnf[] = {
-		0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x30, 0x20, 0x34, 0x30, 0x34,
-		0x20, 0x46, 0x69, 0x6c, 0x65, 0x20, 0x6e, 0x6f, 0x74, 0x20, 0x66, 0x6f,
-		0x75, 0x6e, 0x64, 0x0d, 0x0a
-};
-static const unsigned int http_404fnf_len = 29;
-
-/* Server: edyht - based on lwIP */
-static const unsigned char http_server[] = {
-		0x53, 0x65, 0x72, 0x76, 0x65, 0x72, 0x3a, 0x20, 0x65, 0x64, 0x79, 0x68,
-		0x74, 0x20, 0x2d, 0x20, 0x62, 0x61, 0x73, 0x65, 0x64, 0x20, 0x6f, 0x6e,
-		0x20, 0x6c, 0x77, 0x49, 0x50, 0x0d,	0x0a
-};
-static unsigned int http_server_len = 31;
-
-/* "Content-type: text/html */
-static const unsigned char http_content_html[] = {
-		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
-		0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x68, 0x74, 0x6d, 0x6c, 0x0d,
-		0x0a, 0x0d, 0x0a
-};
-static const unsigned int http_content_html_len = 27;
-
-/* "Content-type: text/csv */
-static const unsigned char http_content_csv[] = {
-		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
-		0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x63, 0x73, 0x76, 0x0d, 0x0a,
-		0x0d, 0x0a
-};
-static const unsigned int http_content_csv_len = 26;
-
-/* "Content-type: image/png */
-static const unsigned char http_content_png[] = {
-		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
-		0x3a, 0x20, 0x69, 0x6d,	0x61, 0x67, 0x65, 0x2f, 0x70, 0x6e, 0x67, 0x0d,
-		0x0a, 0x0d, 0x0a
-};
-static const unsigned int http_content_png_len = 27;
-
-/* "Content-type: application/json */
-static const unsigned char http_content_json[] = {
-		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
-		0x3a, 0x20, 0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6F,
-		0x6e, 0x2f, 0x6a, 0x73, 0x6f, 0x6e, 0x0d, 0x0a, 0x0d, 0x0a
-};
-static const unsigned int http_content_json_len = 34;
-
-/* "Content-type: text/javascript */
-static const unsigned char http_content_js[] = {
-		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
-		0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x6a, 0x61, 0x76, 0x61, 0x73,
-		0x63, 0x72, 0x69, 0x70, 0x74, 0x0d,	0x0a, 0x0d, 0x0a
-};
-static const unsigned int http_content_js_len = 33;
-
-/* "Content-type: text/plain */
-static const unsigned char http_content_plain[] = {
-		0x43,0x6f,0x6e,0x74,0x65,0x6e,0x74,0x2d,0x74,0x79,0x70,0x65,0x3a,0x20,
-		0x74,0x65,0x78,0x74,0x2f,0x70,0x6c,0x61,0x69,0x6e,0x0d,0x0a,0x0d,0x0a
-};
-static const unsigned int http_content_plain_len = 28;
-
-#define ENTRY_LEN   16
-#define LIST_LEN    10
-
-typedef struct {
-	char name[ENTRY_LEN+1]; //leave one more element for terminating "0"
-	char value[ENTRY_LEN+1]; //leave one more element for terminating "0"
-} nameVal_t;
-
-static char filename[ENTRY_LEN+1]; //leave one more element for terminating "0"
-static nameVal_t queryList[LIST_LEN];
-
-
-static enum {
-	urlState_GET,
-	urlState_filename,
-	urlState_queryName,
-	urlState_queryVal,
-} urlState;
-
-
-static int cntChar;
-static int cntElements;  //0 means only filename, otherwise no of query elements
-static inline void charProcessInit(void){
-	cntChar = 0;
-	cntElements = 0;
-	urlState = urlState_GET;
-}
-
-#define CHARPROC_OK             0
-#define CHARPROC_FINISHED       1
-#define CHARPROC_ERR_REQUEST   -1
-#define CHARPROC_ERR_OWFL      -2
-#define CHARPROC_ERR_WRONGCHAR -3
-
-static inline int charProcess(char inChar){
-
-	const char* getStr = "GET /";
-
-	//Process only alphanumeric characters and
-	if((inChar >= 0x20) && (inChar <= 0x7e))
-
-		switch(urlState){
-		case urlState_GET:
-			if(inChar != getStr[cntChar]) return CHARPROC_ERR_REQUEST;
-			cntChar++;
-			if(cntChar == 5){
-				cntChar = 0;
-				urlState = urlState_filename;
-			}
-			break;
-
-		case urlState_filename:
-			if(inChar == ' '){
-				//Space detected -> end completely
-				filename[cntChar] = '\0';
-				return CHARPROC_FINISHED;
-			}
-			if(inChar == '?'){
-				//Query detected -> go Query
-				filename[cntChar] = '\0';
-				cntChar = 0;
-				urlState = urlState_queryName;
-				break;
-			}
-			if(cntChar >= ENTRY_LEN) return CHARPROC_ERR_OWFL;
-			//possible extension: Maybe tolerate other chars like "_"
-			if( ((inChar >= '0') && (inChar <= '9'))
-					|| (inChar >= 'A' && inChar <= 'Z')
-					|| (inChar >= 'a' && inChar <= 'z')
-					|| (inChar == '.')){
-				filename[cntChar] = inChar;
-				cntChar++;
-				break;
-			}
-			return(CHARPROC_ERR_WRONGCHAR);
-
-		case urlState_queryName:
-			if(cntElements >= LIST_LEN) return CHARPROC_ERR_OWFL;
-			if(inChar == '='){
-				//Value detected -> go value
-				queryList[cntElements].name[cntChar] = '\0';
-				cntChar = 0;
-				urlState = urlState_queryVal;
-				break;
-			}
-			if(cntChar >= ENTRY_LEN) return CHARPROC_ERR_OWFL;
-			if( ((inChar >= '0') && (inChar <= '9'))
-					|| (inChar >= 'A' && inChar <= 'Z')
-					|| (inChar >= 'a' && inChar <= 'z')
-					|| (inChar == '.')
-					|| (inChar == '_' )){
-				queryList[cntElements].name[cntChar] = inChar;
-				cntChar++;
-				break;
-			}
-			return(CHARPROC_ERR_WRONGCHAR);
-
-		case urlState_queryVal:
-			if(inChar == ' '){
-				//Space detected -> end completely
-				queryList[cntElements].value[cntChar] = '\0';
-				cntElements++;
-				return CHARPROC_FINISHED;
-			}
-			if(inChar == '&'){
-				//Next token detected -> go Name
-				queryList[cntElements].value[cntChar] = '\0';
-				cntChar = 0;
-				cntElements++;
-				urlState = urlState_queryName;
-				break;
-			}
-			if(cntChar >= ENTRY_LEN) return CHARPROC_ERR_OWFL;
-			//possible extension:  Maybe tolerate other chars like "_"
-			if( ((inChar >= '0') && (inChar <= '9'))
-					|| (inChar >= 'A' && inChar <= 'Z')
-					|| (inChar >= 'a' && inChar <= 'z')
-					|| (inChar == '.')
-					|| (inChar == '-')){
-				queryList[cntElements].value[cntChar] = inChar;
-				cntChar++;
-				break;
-			}
-			if(inChar == '+'){
-				queryList[cntElements].value[cntChar] = ' ';
-				cntChar++;
-				break;
-			}
-			return(CHARPROC_ERR_WRONGCHAR);
-		}
-
-	return(CHARPROC_OK);
-}
-
-static int array[1000];
-static void arrayProcess(struct netconn *conn){
-	char val[20];
-	memset(val, 0,20);
-
-	for(int pos = 0; pos<1000; pos++){
-		array[pos] = pos/2 + 1 + pos/3; //fill some "random" data to array
-		if(pos == 0){
-			sprintf(val, "%d", array[pos]);
-		}
-		else{
-			sprintf(val, ",%d", array[pos]);
-		}
-		netconn_write(conn, val, strlen(val), NETCONN_COPY);
-	}
-}
-
-static void queryShow(struct netconn *conn){
-
-	char line[200];
-	memset(line, 0,200);
-
-	sprintf(line, "Number of elements: %d\n", cntElements);
-	netconn_write(conn, line, strlen(line), NETCONN_COPY);
-
-	sprintf(line, "<table>\n");
-	netconn_write(conn, line, strlen(line), NETCONN_COPY);
-
-	int i;
-	for(i=0;i<cntElements;i++){
-		sprintf(line, "<tr><td>%s <td>%s\n", queryList[i].name, queryList[i].value);
-		netconn_write(conn, line, strlen(line), NETCONN_COPY);
-	}
-	sprintf(line, "</table>\n");
-	netconn_write(conn, line, strlen(line), NETCONN_COPY);
-}
-
-
-static inline void webpageProcess(struct netconn *conn){
-
-	if((strncmp(filename, "", ENTRY_LEN) == 0) || (strncmp(filename, "index.htm", ENTRY_LEN) == 0))
-	{
-		netconn_write(conn, http_200ok, http_200ok_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_server, http_server_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_content_html, http_content_html_len, NETCONN_NOCOPY);
-		netconn_write(conn, htdocs_index_htm, htdocs_index_htm_len, NETCONN_NOCOPY);
-	}
-	else if(strncmp(filename, "credits.htm", ENTRY_LEN) == 0)
-	{
-		netconn_write(conn, http_200ok, http_200ok_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_server, http_server_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_content_html, http_content_html_len, NETCONN_NOCOPY);
-		netconn_write(conn, htdocs_credits_htm, htdocs_credits_htm_len, NETCONN_NOCOPY);
-	}
-	else if(strncmp(filename, "tasks.htm", ENTRY_LEN) == 0)
-	{
-		netconn_write(conn, http_200ok, http_200ok_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_server, http_server_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_content_html, http_content_html_len, NETCONN_NOCOPY);
-		netconn_write(conn, htdocs_tasks_begin_htm, htdocs_tasks_begin_htm_len, NETCONN_NOCOPY);
-		/* Load dynamic page part */
-		page_FreeRTOS_Tasks(conn);
-		netconn_write(conn, htdocs_tasks_end_htm, htdocs_tasks_end_htm_len, NETCONN_NOCOPY);
-
-	}
-	else if(strncmp(filename, "lwip.htm", ENTRY_LEN) == 0)
-	{
-		netconn_write(conn, http_200ok, http_200ok_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_server, http_server_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_content_html, http_content_html_len, NETCONN_NOCOPY);
-		netconn_write(conn, htdocs_lwip_begin_htm, htdocs_lwip_begin_htm_len, NETCONN_NOCOPY);
-		/* Load dynamic page part */
-		//page_LwIP_Info(conn);
-		netconn_write(conn, htdocs_lwip_end_htm, htdocs_lwip_end_htm_len, NETCONN_NOCOPY);
-	}
-	else if(strncmp(filename, "testform.htm", ENTRY_LEN) == 0)
-	{
-		netconn_write(conn, http_200ok, http_200ok_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_server, http_server_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_content_html, http_content_html_len, NETCONN_NOCOPY);
-		netconn_write(conn, htdocs_testform_begin_htm, htdocs_testform_begin_htm_len, NETCONN_NOCOPY);
-		queryShow(conn);
-		netconn_write(conn, htdocs_testform_end_htm, htdocs_testform_end_htm_len, NETCONN_NOCOPY);
-	}
-	else if(strncmp(filename, "test.json", ENTRY_LEN) == 0)
-	{
-		netconn_write(conn, http_200ok, http_200ok_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_server, http_server_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_content_json, http_content_json_len, NETCONN_NOCOPY);
-		char *begin_json_array = "{\n\"val\":[";
-		netconn_write(conn, begin_json_array, strlen(begin_json_array), NETCONN_NOCOPY);
-		arrayProcess(conn);
-		char *end_json_array = "]\n}";
-		netconn_write(conn, end_json_array, strlen(end_json_array), NETCONN_NOCOPY);
-	}
-	//  favicon.ico might be automatically fetched by some browsers, e.g. firefox
-	//	else if(strncmp(filename, "favicon.png", ENTRY_LEN) == 0)
-	//	{
-	//		netconn_write(conn, http_200ok, http_200ok_len, NETCONN_NOCOPY);
-	//		netconn_write(conn, http_server, http_server_len, NETCONN_NOCOPY);
-	//		netconn_write(conn, http_content_png, http_content_png_len, NETCONN_NOCOPY);
-	//		netconn_write(conn, htdocs_favicon_png, htdocs_favicon_png_len, NETCONN_NOCOPY);
-	//	}
-	else
-	{
-		/* Show error page */
-		netconn_write(conn, http_404fnf, http_404fnf_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_server, http_server_len, NETCONN_NOCOPY);
-		netconn_write(conn, http_content_html, http_content_html_len, NETCONN_NOCOPY);
-		netconn_write(conn, htdocs_err404_htm, htdocs_err404_htm_len, NETCONN_NOCOPY);
-	}
-}
-
-static inline void webpageBadProcess(struct netconn *conn){
-	netconn_write(conn, http_400bad, http_400bad_len, NETCONN_NOCOPY);
-	netconn_write(conn, http_server, http_server_len, NETCONN_NOCOPY);
-	//improve: Add some html info
-	netconn_write(conn, http_content_plain, http_content_plain_len, NETCONN_NOCOPY);
-	netconn_write(conn, "ERR\n", 4, NETCONN_NOCOPY);
-}
-
-static void serve_get_request(struct netconn *conn)
-{
-	struct netbuf *inbuf;
-	err_t recv_err;
-	char* buf;
-	u16_t buflen;
-	int doexit = 0;
-	char myChar;
-
-	//Set timeout
-	netconn_set_recvtimeout ( conn, 2000 );
-
-	charProcessInit();
-
-	do{
-		// Receive data
-		recv_err = netconn_recv(conn, &inbuf);
-
-		if (recv_err == ERR_OK)	{
-			if (netconn_err(conn) == ERR_OK) {
-				do {
-					//Get data from netbuf
-					netbuf_data(inbuf, (void**)&buf, &buflen);
-
-					int i;
-					//process data byte by byte
-					for(i=0; i<buflen; i++){
-						myChar = buf[i];
-
-						int ret = charProcess(myChar);
-
-						if(ret < 0) {
-							//Error!
-							webpageBadProcess(conn);
-							doexit = 4;
-							break;
-						};
-
-						if(ret == 1){
-							//Process Webpage
-							webpageProcess(conn);
-							//Exit regularly
-							doexit = 100;
-							break;
-						}
-
-					} //for(i=0; i<buflen; i++){
-				} while((netbuf_next(inbuf) >= 0) && (doexit==0));
-			} //if (netconn_err(conn) == ERR_OK)
-			else {
-				doexit = 3;
-			}
-		} //if (recv_err == ERR_OK)
-		else {
-			doexit = 2;
-		}
-
-		// delete buffer)
-		netbuf_delete(inbuf);
-
-	} while(doexit == 0);
-
-
-	// close connection
-	netconn_close(conn);
-}
-
-
-static void edyht_thread(void *arg)
-{ 
-	struct netconn *conn, *newconn;
-	err_t err, accept_err;
-
-	conn = netconn_new(NETCONN_TCP);
-
-	if (conn!= NULL)
-	{
-		//bind (http port)
-		err = netconn_bind(conn, NULL, 80);
-
-		if (err == ERR_OK)
-		{
-			netconn_listen(conn);
-			while(1)
-			{
-				//wait for incoming connection
-				accept_err = netconn_accept(conn, &newconn);
-				if(accept_err == ERR_OK)
-				{
-					//serve request
-					serve_get_request(newconn);
-					netconn_delete(newconn);
-				}
-			}
-		}
-		else
-		{
-			//improvement: Notify error!
-			netconn_delete(newconn);
-		}
-	}
-	else
-	{
-		//improvement: Notify error!
-	}
-	for(;;); //send thread to endless loop; should not happen!
-}
-
-void edyht_init()
-{
-	sys_thread_new("edyht", edyht_thread, NULL, 2500, EDYHT_PRIO);
-}
-
-static void page_FreeRTOS_Tasks(struct netconn *conn)
-{
-	portCHAR buffer[1000];
-	time_t myTime;
-
-	netconn_write(conn, "<pre>\r\n",7,NETCONN_COPY);
-	netconn_write(conn, "Name          State  Priority  Stack   Num\r\n", 44, NETCONN_COPY);
-	netconn_write(conn, "------------------------------------------\r\n", 44, NETCONN_COPY);
-
-	//Create Task List
-	memset(buffer, 0,1000);
-	vTaskList(buffer);
-	//vTaskGetRunTimeStats(buffer);
-	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-
-	netconn_write(conn, "------------------------------------------\r\n", 44, NETCONN_COPY);
-	netconn_write(conn, "System Time: ", 13, NETCONN_COPY);
-
-	time(&myTime);
-	memset(buffer, 0,1000);
-	ctime_r(&myTime, buffer );
-	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-
-	netconn_write(conn, "</pre>\r\n", 8, NETCONN_COPY);
-}
-
-//void lwip_display_toString(struct stats_proto *proto, const char *name, char* string)
-//{
-//	char tmp[100];
-//	sprintf(string, "\n%s\n\t", name);
-//	sprintf(tmp, "xmit: %d\n\t", proto->xmit);
-//	strcat(string, tmp);
-//	sprintf(tmp, "recv: %d\n\t", proto->recv);
-//	strcat(string, tmp);
-//	sprintf(tmp, "fw: %d\n\t", proto->fw);
-//	strcat(string, tmp);
-//	sprintf(tmp, "drop: %d\n\t", proto->drop);
-//	strcat(string, tmp);
-//	sprintf(tmp, "chkerr: %d\n\t", proto->chkerr);
-//	strcat(string, tmp);
-//	sprintf(tmp, "lenerr: %d\n\t", proto->lenerr);
-//	strcat(string, tmp);
-//	sprintf(tmp, "memerr: %d\n\t", proto->memerr);
-//	strcat(string, tmp);
-//	sprintf(tmp, "rterr: %d\n\t", proto->rterr);
-//	strcat(string, tmp);
-//	sprintf(tmp, "proterr: %d\n\t", proto->proterr);
-//	strcat(string, tmp);
-//	sprintf(tmp, "opterr: %d\n\t", proto->opterr);
-//	strcat(string, tmp);
-//	sprintf(tmp, "err: %d\n\t", proto->err);
-//	strcat(string, tmp);
-//	sprintf(tmp, "cachehit: %d\n", proto->cachehit);
-//	strcat(string, tmp);
-//}
-//
-//static void lwip_display_mem_toString(struct stats_mem *mem, const char *name, char* string)
-//{
-//	char tmp[100];
-//	sprintf(string, "\nMEM %s\n\t", name);
-//	sprintf(tmp, "avail: %lu\n\t", (u32_t)mem->avail);
-//	strcat(string, tmp);
-//	sprintf(tmp, "used: %lu\n\t", (u32_t)mem->used);
-//	strcat(string, tmp);
-//	sprintf(tmp, "max: %lu\n\t", (u32_t)mem->max);
-//	strcat(string, tmp);
-//	sprintf(tmp, "err: %lu\n", (u32_t)mem->err);
-//	strcat(string, tmp);
-//}
-//
-//static void lwip_display_sys_toString(struct stats_sys *sys, char* string)
-//{
-//	char tmp[100];
-//	sprintf(string, "\nSYS\n\t");
-//	sprintf(tmp, "sem.used:  %lu\n\t", (u32_t)sys->sem.used);
-//	strcat(string, tmp);
-//	sprintf(tmp, "sem.max:   %lu\n\t", (u32_t)sys->sem.max);
-//	strcat(string, tmp);
-//	sprintf(tmp, "sem.err:   %lu\n\t", (u32_t)sys->sem.err);
-//	strcat(string, tmp);
-//	sprintf(tmp, "mutex.used: %lu\n\t", (u32_t)sys->mutex.used);
-//	strcat(string, tmp);
-//	sprintf(tmp, "mutex.max:  %lu\n\t", (u32_t)sys->mutex.max);
-//	strcat(string, tmp);
-//	sprintf(tmp, "mutex.err:  %lu\n\t", (u32_t)sys->mutex.err);
-//	strcat(string, tmp);
-//	sprintf(tmp, "mbox.used:  %lu\n\t", (u32_t)sys->mbox.used);
-//	strcat(string, tmp);
-//	sprintf(tmp, "mbox.max:   %lu\n\t", (u32_t)sys->mbox.max);
-//	strcat(string, tmp);
-//	sprintf(tmp, "mbox.err:   %lu\n\t", (u32_t)sys->mbox.err);
-//	strcat(string, tmp);
-//}
-//
-//
-//static void page_LwIP_Info(struct netconn *conn)
-//{
-//	portCHAR buffer[1000];
-//
-//	netconn_write(conn, "<pre>\r\n",7,NETCONN_COPY);
-//	netconn_write(conn, "Test lwIP Stats:                          \r\n", 44, NETCONN_COPY);
-//	netconn_write(conn, "------------------------------------------\r\n", 44, NETCONN_COPY);
-//
-//	memset(buffer, 0,1000);
-//
-//	lwip_display_toString(&lwip_stats.link, "LINK", buffer);
-//	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-//
-//	lwip_display_toString(&lwip_stats.ip, "IP", buffer);
-//	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-//
-//	lwip_display_toString(&lwip_stats.icmp, "ICMP", buffer);
-//	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-//
-//	lwip_display_toString(&lwip_stats.tcp, "TCP", buffer);
-//	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-//
-//	lwip_display_toString(&lwip_stats.udp, "UDP", buffer);
-//	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-//
-//	lwip_display_toString(&lwip_stats.etharp, "ETHARP", buffer);
-//	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-//
-//	lwip_display_mem_toString(&lwip_stats.mem, "HEAP", buffer);
-//	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-//
-//	lwip_display_sys_toString(&lwip_stats.sys, buffer);
-//	netconn_write(conn, buffer, strlen(buffer), NETCONN_COPY);
-//
-//	netconn_write(conn, "</pre>\r\n", 8, NETCONN_COPY);
-//}
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht.c
+ * @author Fabian Mink
+ * @date 2017-07-25
+ * @brief edyht - Embedded DYnamic Http server
+ * @copyright BSD 2-Clause License
+ *
+ * Embedded DYnamic Http server for use with the lwIP TCP/IP stack.
+ * Partially based on the httpserver-netconn example of lwIP contribution package
+ *
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "lwip/opt.h"
+#include "lwip/arch.h"
+#include "edyht.h"
+#include "edyht_fmt.h"
+#include "edyht_parse.h"
+#include "edyht_sse.h"
+#include "edyht_ws.h"
+#include "edyht_form.h"
+#include "edyht_metrics.h"
+#include "edyht_lwipstats.h"
+#include "edyht_tasks.h"
+#include "edyht_snap.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/sys.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+#if EDYHT_RAW_API
+#include "lwip/pbuf.h"
+#include "lwip/timeouts.h"
+#else
+#include "lwip/api.h"
+#include "queue.h"
+#endif
+
+
+typedef struct {
+	const char *name;              //route name, NULL: not served directly (parts/, error pages)
+	const unsigned char *data;     //response header followed by body, no header for parts/
+	unsigned int hdrLen;
+	unsigned int len;              //body length
+	u32_t hash;                    //FNV-1a hash of body
+	const unsigned char *gz;       //gzip response, NULL if not generated
+	unsigned int gzHdrLen;
+	unsigned int gzLen;
+} asset_t;
+
+#define TPL_SLOT_NONE  0xffff
+
+//Static text of a template up to the next placeholder
+typedef struct {
+	unsigned int len;
+	u16_t slot;                    //index in tplSlotNames, TPL_SLOT_NONE: end of template
+} tplSeg_t;
+
+typedef struct {
+	const char *name;              //route name, NULL: end of table
+	edyht_content_t type;
+	const unsigned char *text;     //static text of all segments
+	const tplSeg_t *segs;
+	unsigned int nSegs;
+} template_t;
+
+//Generate by "./mkhtdocs.sh" from htdocs/
+#include "edyht_assets.inc"
+
+/* HTTP/1.1 200 OK */
+static const unsigned char http_200ok[] = {
+		0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x31, 0x20, 0x32, 0x30, 0x30,
+		0x20, 0x4f, 0x4b, 0x0d, 0x0a
+};
+static const unsigned int http_200ok_len = 17;
+
+/* HTTP/1.1 304 Not Modified */
+static const unsigned char http_304nm[] = {
+		0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x31, 0x20, 0x33, 0x30, 0x34,
+		0x20, 0x4e, 0x6f, 0x74, 0x20, 0x4d, 0x6f, 0x64, 0x69, 0x66, 0x69, 0x65,
+		0x64, 0x0d, 0x0a
+};
+static const unsigned int http_304nm_len = 27;
+
+/* HTTP/1.1 100 Continue, empty line */
+static const unsigned char http_100cont[] = {
+		0x48,0x54,0x54,0x50,0x2f,0x31,0x2e,0x31,0x20,0x31,0x30,0x30,0x20,0x43,
+		0x6f,0x6e,0x74,0x69,0x6e,0x75,0x65,0x0d,0x0a,0x0d,0x0a
+};
+static const unsigned int http_100cont_len = 25;
+
+/* HTTP/1.1 101 Switching Protocols, Upgrade: websocket, Connection: Upgrade */
+static const unsigned char http_101ws[] = {
+		0x48, 0x54, 0x54, 0x50, 0x2f, 0x31, 0x2e, 0x31, 0x20, 0x31, 0x30, 0x31,
+		0x20, 0x53, 0x77, 0x69, 0x74, 0x63, 0x68, 0x69, 0x6e, 0x67, 0x20, 0x50,
+		0x72, 0x6f, 0x74, 0x6f, 0x63, 0x6f, 0x6c, 0x73, 0x0d, 0x0a, 0x55, 0x70,
+		0x67, 0x72, 0x61, 0x64, 0x65, 0x3a, 0x20, 0x77, 0x65, 0x62, 0x73, 0x6f,
+		0x63, 0x6b, 0x65, 0x74, 0x0d, 0x0a, 0x43, 0x6f, 0x6e, 0x6e, 0x65, 0x63,
+		0x74, 0x69, 0x6f, 0x6e, 0x3a, 0x20, 0x55, 0x70, 0x67, 0x72, 0x61, 0x64,
+		0x65, 0x0d, 0x0a
+};
+static const unsigned int http_101ws_len = 75;
+
+/* Server: edyht - based on lwIP */
+static const unsigned char http_server[] = {
+		0x53, 0x65, 0x72, 0x76, 0x65, 0x72, 0x3a, 0x20, 0x65, 0x64, 0x79, 0x68,
+		0x74, 0x20, 0x2d, 0x20, 0x62, 0x61, 0x73, 0x65, 0x64, 0x20, 0x6f, 0x6e,
+		0x20, 0x6c, 0x77, 0x49, 0x50, 0x0d,	0x0a
+};
+static unsigned int http_server_len = 31;
+
+/* Transfer-Encoding: chunked */
+static const unsigned char http_chunked[] = {
+		0x54, 0x72, 0x61, 0x6e, 0x73, 0x66, 0x65, 0x72, 0x2d, 0x45, 0x6e, 0x63,
+		0x6f, 0x64, 0x69, 0x6e, 0x67, 0x3a, 0x20, 0x63, 0x68, 0x75, 0x6e, 0x6b,
+		0x65, 0x64, 0x0d, 0x0a
+};
+static const unsigned int http_chunked_len = 28;
+
+/* Connection: close */
+static const unsigned char http_close[] = {
+		0x43, 0x6f, 0x6e, 0x6e, 0x65, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x3a, 0x20,
+		0x63, 0x6c, 0x6f, 0x73, 0x65, 0x0d, 0x0a
+};
+static const unsigned int http_close_len = 19;
+
+/* Cache-Control: no-cache */
+static const unsigned char http_nocache[] = {
+		0x43, 0x61, 0x63, 0x68, 0x65, 0x2d, 0x43, 0x6f, 0x6e, 0x74, 0x72, 0x6f,
+		0x6c, 0x3a, 0x20, 0x6e, 0x6f, 0x2d, 0x63, 0x61, 0x63, 0x68, 0x65, 0x0d,
+		0x0a
+};
+static const unsigned int http_nocache_len = 25;
+
+/* Vary: Accept-Encoding */
+static const unsigned char http_vary[] = {
+		0x56, 0x61, 0x72, 0x79, 0x3a, 0x20, 0x41, 0x63, 0x63, 0x65, 0x70, 0x74,
+		0x2d, 0x45, 0x6e, 0x63, 0x6f, 0x64, 0x69, 0x6e, 0x67, 0x0d, 0x0a
+};
+
+/* Vary: Accept */
+static const unsigned char http_vary_accept[] = {
+		0x56, 0x61, 0x72, 0x79, 0x3a, 0x20, 0x41, 0x63, 0x63, 0x65, 0x70, 0x74,
+		0x0d, 0x0a
+};
+
+/* "Content-type: text/html */
+static const unsigned char http_content_html[] = {
+		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
+		0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x68, 0x74, 0x6d, 0x6c, 0x0d,
+		0x0a, 0x0d, 0x0a
+};
+
+/* "Content-type: text/csv */
+static const unsigned char http_content_csv[] = {
+		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
+		0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x63, 0x73, 0x76, 0x0d, 0x0a,
+		0x0d, 0x0a
+};
+
+/* "Content-type: image/png */
+static const unsigned char http_content_png[] = {
+		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
+		0x3a, 0x20, 0x69, 0x6d,	0x61, 0x67, 0x65, 0x2f, 0x70, 0x6e, 0x67, 0x0d,
+		0x0a, 0x0d, 0x0a
+};
+
+/* "Content-type: application/json */
+static const unsigned char http_content_json[] = {
+		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
+		0x3a, 0x20, 0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6F,
+		0x6e, 0x2f, 0x6a, 0x73, 0x6f, 0x6e, 0x0d, 0x0a, 0x0d, 0x0a
+};
+
+/* "Content-type: text/javascript */
+static const unsigned char http_content_js[] = {
+		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
+		0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x6a, 0x61, 0x76, 0x61, 0x73,
+		0x63, 0x72, 0x69, 0x70, 0x74, 0x0d,	0x0a, 0x0d, 0x0a
+};
+
+/* "Content-type: text/plain */
+static const unsigned char http_content_plain[] = {
+		0x43,0x6f,0x6e,0x74,0x65,0x6e,0x74,0x2d,0x74,0x79,0x70,0x65,0x3a,0x20,
+		0x74,0x65,0x78,0x74,0x2f,0x70,0x6c,0x61,0x69,0x6e,0x0d,0x0a,0x0d,0x0a
+};
+
+/* "Content-type: application/cbor */
+static const unsigned char http_content_cbor[] = {
+		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
+		0x3a, 0x20, 0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f,
+		0x6e, 0x2f, 0x63, 0x62, 0x6f, 0x72, 0x0d, 0x0a, 0x0d, 0x0a
+};
+
+/* "Content-type: application/octet-stream */
+static const unsigned char http_content_binary[] = {
+		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
+		0x3a, 0x20, 0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f,
+		0x6e, 0x2f, 0x6f, 0x63, 0x74, 0x65, 0x74, 0x2d, 0x73, 0x74, 0x72, 0x65,
+		0x61, 0x6d, 0x0d, 0x0a, 0x0d, 0x0a
+};
+
+/* "Content-type: text/event-stream */
+static const unsigned char http_content_events[] = {
+		0x43, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x2d, 0x74, 0x79, 0x70, 0x65,
+		0x3a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2f, 0x65, 0x76, 0x65, 0x6e, 0x74,
+		0x2d, 0x73, 0x74, 0x72, 0x65, 0x61, 0x6d, 0x0d, 0x0a, 0x0d, 0x0a
+};
+static const unsigned int http_content_events_len = 35;
+
+/* Transport: netconn API or lwIP raw API (EDYHT_RAW_API) */
+#define WRITE_NOCOPY   0x00    //data stays valid (const), values match NETCONN_* and TCP_WRITE_FLAG_*
+#define WRITE_COPY     0x01
+#define WRITE_MORE     0x02
+
+#if EDYHT_RAW_API
+typedef struct rawConn conn_t;
+static err_t connWrite(conn_t *conn, const void *data, unsigned int len, u8_t flags);
+static void connPush(conn_t *conn);
+static void connNoDelay(conn_t *conn);
+#define WS_LOCK(ws)
+#define WS_UNLOCK(ws)
+#define CACHE_LOCK()
+#define CACHE_UNLOCK()
+#else
+typedef struct netconn conn_t;
+static inline err_t connWrite(conn_t *conn, const void *data, unsigned int len, u8_t flags){
+	return netconn_write(conn, data, len, flags);
+}
+//Data written outside of a response, netconn_write already sends it
+static inline void connPush(conn_t *conn){
+	LWIP_UNUSED_ARG(conn);
+}
+static inline void connNoDelay(conn_t *conn){
+	LOCK_TCPIP_CORE();
+	tcp_nagle_disable(conn->pcb.tcp);
+	UNLOCK_TCPIP_CORE();
+}
+//WebSocket frames are written by workers and application tasks, one lock
+//per connection so that a stalled client does not hold up the others
+#define WS_LOCK(ws)    sys_mutex_lock(&(ws)->lock)
+#define WS_UNLOCK(ws)  sys_mutex_unlock(&(ws)->lock)
+//Response cache, shared by the workers
+static sys_mutex_t cacheMutex;
+#define CACHE_LOCK()    sys_mutex_lock(&cacheMutex)
+#define CACHE_UNLOCK()  sys_mutex_unlock(&cacheMutex)
+#endif
+
+#define CHUNK_HDR_LEN  6       //"XXXX\r\n", fixed width hex size with leading zeros
+#define CHUNK_TRL_LEN  2       //"\r\n" after chunk data
+#define CHUNK_MAX      0xffff
+
+#if EDYHT_WRITER_LEN > CHUNK_MAX
+#error "EDYHT_WRITER_LEN too large for chunk header"
+#endif
+
+struct edyht_writer {
+	conn_t *conn;
+	const edyht_req_t *req;       //parsed request of this connection
+	err_t err;                   //first write error, further output is dropped
+	u8_t keepAlive;              //connection stays open after this response
+	u8_t chunked;                //body is sent with chunked transfer encoding
+	u8_t head;                   //HEAD request: the body is not sent
+	u8_t drop;                   //header of a HEAD response sent, further output is dropped
+	unsigned int len;
+	unsigned int chunkStart;     //start of data of the open chunk in buf
+	u32_t sent;                  //bytes handed to lwIP, for the metrics
+	u8_t *cap;                   //response cache: output goes here instead of conn
+	unsigned int capLen;
+	unsigned int capMax;
+	u8_t capType;                //content type of the captured response
+	char buf[EDYHT_WRITER_LEN];
+};
+
+static inline void writerInit(edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, u8_t keepAlive){
+	w->conn = conn;
+	w->req = req;
+	w->err = ERR_OK;
+	w->keepAlive = keepAlive;
+	w->chunked = 0;
+	w->head = (req->method == EDYHT_METHOD_HEAD);
+	w->drop = 0;
+	w->len = 0;
+	w->cap = NULL;
+}
+
+static void capSpill(edyht_writer_t *w);
+
+static inline void writerSend(edyht_writer_t *w, const void *data, unsigned int len, u8_t flags){
+	if((w->err != ERR_OK) || w->drop) return;
+	if(w->cap != NULL){
+		if(w->capLen + len <= w->capMax){
+			memcpy(&w->cap[w->capLen], data, len);
+			w->capLen += len;
+			return;
+		}
+		capSpill(w);
+		if((w->err != ERR_OK) || w->drop) return;
+	}
+	w->err = connWrite(w->conn, data, len, flags);
+	w->sent += len;
+}
+
+//Free space for body data, keeps room for the chunk trailer
+static inline unsigned int writerSpace(const edyht_writer_t *w){
+	return EDYHT_WRITER_LEN - w->len - (w->chunked ? CHUNK_TRL_LEN : 0);
+}
+
+static inline void chunkHeader(char *dst, unsigned int size){
+	static const char hex[] = "0123456789abcdef";
+	dst[0] = hex[(size >> 12) & 0xf];
+	dst[1] = hex[(size >> 8) & 0xf];
+	dst[2] = hex[(size >> 4) & 0xf];
+	dst[3] = hex[size & 0xf];
+	dst[4] = '\r';
+	dst[5] = '\n';
+}
+
+//Send buffer content as is
+static inline void writerSendBuf(edyht_writer_t *w, u8_t more){
+	if(w->len == 0) return;
+	writerSend(w, w->buf, w->len, WRITE_COPY | more);
+	w->len = 0;
+}
+
+static inline void chunkOpen(edyht_writer_t *w){
+	if(EDYHT_WRITER_LEN - w->len < CHUNK_HDR_LEN + CHUNK_TRL_LEN + 1) writerSendBuf(w, WRITE_MORE);
+	w->len += CHUNK_HDR_LEN;
+	w->chunkStart = w->len;
+}
+
+static inline void chunkClose(edyht_writer_t *w){
+	unsigned int size = w->len - w->chunkStart;
+	if(size == 0){
+		w->len -= CHUNK_HDR_LEN; //drop empty chunk
+		return;
+	}
+	chunkHeader(&w->buf[w->chunkStart - CHUNK_HDR_LEN], size);
+	w->buf[w->len++] = '\r';
+	w->buf[w->len++] = '\n';
+}
+
+//more = WRITE_MORE if further data follows (no PSH flag)
+static inline void writerFlush(edyht_writer_t *w, u8_t more){
+	if(w->chunked) chunkClose(w);
+	writerSendBuf(w, more);
+	if(w->chunked) chunkOpen(w);
+}
+
+//Finish response: last chunk and flush without WRITE_MORE
+static void writerEnd(edyht_writer_t *w){
+	if(w->chunked){
+		chunkClose(w);
+		w->chunked = 0;
+		if(EDYHT_WRITER_LEN - w->len < 5) writerSendBuf(w, WRITE_MORE);
+		memcpy(&w->buf[w->len], "0\r\n\r\n", 5);
+		w->len += 5;
+	}
+	writerSendBuf(w, 0);
+}
+
+void edyht_write(edyht_writer_t *w, const void *data, unsigned int len){
+	const char *src = data;
+	while(len > 0){
+		unsigned int n = writerSpace(w);
+		if(n == 0){
+			writerFlush(w, WRITE_MORE);
+			continue;
+		}
+		if(n > len) n = len;
+		memcpy(&w->buf[w->len], src, n);
+		w->len += n;
+		src += n;
+		len -= n;
+	}
+}
+
+void edyht_write_const(edyht_writer_t *w, const void *data, unsigned int len){
+	const unsigned char *src = data;
+
+	if(len <= writerSpace(w)){
+		memcpy(&w->buf[w->len], data, len);
+		w->len += len;
+		return;
+	}
+	if(!w->chunked){
+		writerSendBuf(w, WRITE_MORE);
+		writerSend(w, data, len, WRITE_NOCOPY | WRITE_MORE);
+		return;
+	}
+	//chunked: put own chunk header into buffer, send data zero-copy
+	chunkClose(w);
+	while(len > 0){
+		unsigned int n = (len > CHUNK_MAX) ? CHUNK_MAX : len;
+		if(EDYHT_WRITER_LEN - w->len < CHUNK_HDR_LEN) writerSendBuf(w, WRITE_MORE);
+		chunkHeader(&w->buf[w->len], n);
+		w->len += CHUNK_HDR_LEN;
+		writerSendBuf(w, WRITE_MORE);
+		writerSend(w, src, n, WRITE_NOCOPY | WRITE_MORE);
+		w->buf[w->len++] = '\r';
+		w->buf[w->len++] = '\n';
+		src += n;
+		len -= n;
+	}
+	chunkOpen(w);
+}
+
+void edyht_printf(edyht_writer_t *w, const char *fmt, ...){
+	va_list ap;
+	unsigned int space = writerSpace(w);
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(&w->buf[w->len], space, fmt, ap);
+	va_end(ap);
+	if(n < 0) return;
+
+	if((unsigned int)n >= space){
+		//did not fit, flush and print again into empty buffer
+		writerFlush(w, WRITE_MORE);
+		space = writerSpace(w);
+		va_start(ap, fmt);
+		n = vsnprintf(&w->buf[w->len], space, fmt, ap);
+		va_end(ap);
+		if(n < 0) return;
+		if((unsigned int)n >= space) n = space - 1; //truncated
+	}
+	w->len += n;
+}
+
+void edyht_flush(edyht_writer_t *w){
+	writerFlush(w, 0);
+}
+
+unsigned int edyht_write_space(edyht_writer_t *w){
+	return writerSpace(w);
+}
+
+char* edyht_write_reserve(edyht_writer_t *w, unsigned int len){
+	if(len > EDYHT_WRITER_LEN - CHUNK_HDR_LEN - CHUNK_TRL_LEN) return NULL;
+	if(len > writerSpace(w)){
+		writerFlush(w, WRITE_MORE);
+	}
+	return &w->buf[w->len];
+}
+
+void edyht_write_commit(edyht_writer_t *w, unsigned int len){
+	w->len += len;
+}
+
+/* Test data of test.json / test.csv. A control task would publish its
+ * samples the same way, see edyht_snap.h. */
+#define ARRAY_LEN  1000
+static int arrayBufs[2][ARRAY_LEN];
+static edyht_snap_t arraySnap = EDYHT_SNAP_INIT(arrayBufs);
+
+static void arrayFill(void){
+	int *array = edyht_snap_back(&arraySnap);
+	if(array == NULL) return; //all buffers held by readers, publish next time
+	for(int pos = 0; pos<ARRAY_LEN; pos++){
+		array[pos] = pos/2 + 1 + pos/3; //fill some "random" data to array
+	}
+	edyht_snap_publish(&arraySnap);
+}
+
+//Same data as array endpoint test.dat, format chosen by the client
+static const edyht_array_t arrayEndpoint = { &arraySnap, ARRAY_LEN, EDYHT_ELEM_INT32, 0 };
+
+#define CURSOR_POS  0xffffff
+
+//Provider body of test.json / test.csv, cursor: 0 = start, else held buffer << 24 | index of next value + 1
+static int arrayStream(edyht_writer_t *w, unsigned int *cursor, edyht_fmt_t fmt){
+	unsigned int buf, pos;
+
+	if(w == NULL){
+		//aborted
+		edyht_snap_release(&arraySnap, *cursor >> 24);
+		return 0;
+	}
+	if(*cursor == 0){
+		*cursor = (edyht_snap_hold(&arraySnap) << 24) | 1;
+	}
+	buf = *cursor >> 24;
+	pos = edyht_write_int_array_part(w, edyht_snap_data(&arraySnap, buf), ARRAY_LEN, (*cursor & CURSOR_POS) - 1, fmt);
+	*cursor = (buf << 24) | (pos + 1);
+	if(pos < ARRAY_LEN) return 1;
+	edyht_snap_release(&arraySnap, buf);
+	return 0;
+}
+
+static void queryShow(edyht_writer_t *w){
+
+	const edyht_req_t *req = w->req;
+
+	edyht_printf(w, "Number of elements: %d\n", req->queryCount);
+	edyht_write_const(w, "<table>\n", 8);
+
+	int i;
+	for(i=0;i<req->queryCount;i++){
+		edyht_printf(w, "<tr><td>%s <td>%s\n", req->query[i].name, req->query[i].value);
+	}
+	edyht_write_const(w, "</table>\n", 9);
+}
+
+
+//Send prebuilt blob (headers + body) with a single zero-copy write
+static inline err_t blobSend(conn_t *conn, const unsigned char *blob, unsigned int len){
+	return connWrite(conn, blob, len, WRITE_NOCOPY);
+}
+
+typedef struct {
+	const unsigned char *data;
+	unsigned int len;
+} blob_t;
+
+static const blob_t contentTypes[] = {
+		[EDYHT_CONTENT_NONE]  = { NULL, 0 },
+		[EDYHT_CONTENT_HTML]  = { http_content_html,  sizeof(http_content_html)  },
+		[EDYHT_CONTENT_CSV]   = { http_content_csv,   sizeof(http_content_csv)   },
+		[EDYHT_CONTENT_PNG]   = { http_content_png,   sizeof(http_content_png)   },
+		[EDYHT_CONTENT_JSON]  = { http_content_json,  sizeof(http_content_json)  },
+		[EDYHT_CONTENT_JS]    = { http_content_js,    sizeof(http_content_js)    },
+		[EDYHT_CONTENT_PLAIN] = { http_content_plain, sizeof(http_content_plain) },
+		[EDYHT_CONTENT_CBOR]  = { http_content_cbor,  sizeof(http_content_cbor)  },
+		[EDYHT_CONTENT_BINARY] = { http_content_binary, sizeof(http_content_binary) },
+};
+
+static const blob_t varyEncoding = { http_vary, sizeof(http_vary) };
+static const blob_t varyAccept = { http_vary_accept, sizeof(http_vary_accept) };
+
+//Append "200 OK" header for given content type, contentLength < 0: body length unknown,
+//sent chunked on persistent connections. etag: validator incl. quotes or NULL, vary: header or NULL
+static void headerWrite(edyht_writer_t *w, edyht_content_t type, int contentLength, const char *etag,
+		const blob_t *vary){
+	edyht_write_const(w, http_200ok, http_200ok_len);
+	edyht_write_const(w, http_server, http_server_len);
+	if(contentLength >= 0){
+		edyht_printf(w, "Content-Length: %d\r\n", contentLength);
+	}
+	else if(w->keepAlive){
+		edyht_write_const(w, http_chunked, http_chunked_len);
+	}
+	if(!w->keepAlive && w->req->http11){
+		edyht_write_const(w, http_close, http_close_len);
+	}
+	if(etag != NULL){
+		edyht_printf(w, "ETag: %s\r\n", etag);
+		edyht_write_const(w, http_nocache, http_nocache_len);
+	}
+	if(vary != NULL){
+		edyht_write_const(w, vary->data, vary->len);
+	}
+	edyht_write_const(w, contentTypes[type].data, contentTypes[type].len);
+
+	if(w->head){
+		//same header as GET, the body is produced but not sent
+		writerSendBuf(w, 0);
+		w->drop = 1;
+	}
+	if((contentLength < 0) && w->keepAlive){
+		w->chunked = 1;
+		chunkOpen(w);
+	}
+}
+
+typedef struct {
+	const char *name;           //NULL: slot is empty
+	u32_t hash;
+	edyht_content_t type;
+	edyht_handler_t handler;    //NULL: static asset
+	const unsigned char *data;
+	unsigned int len;
+	const asset_t *asset;       //file from htdocs/, NULL otherwise
+	const volatile unsigned int *version; //content version of a dynamic page, NULL: no ETag
+	edyht_provider_t provider;  //streaming page
+	const edyht_array_t *array; //array endpoint
+	edyht_sse_t *sse;           //event stream
+	edyht_ws_handler_t wsHandler; //WebSocket endpoint
+	edyht_form_field_t field;   //POST form, handler writes the response
+	edyht_body_sink_t sink;     //POST upload, handler writes the response
+	const template_t *tpl;      //template from htdocs/tpl/
+	unsigned int ttl;           //lifetime (ms) of cached responses, 0: not cached
+	u8_t metric;                //counter slot, see edyht_metrics.h
+} route_t;
+
+#if (EDYHT_ROUTES_SIZE & (EDYHT_ROUTES_SIZE - 1)) != 0
+#error "EDYHT_ROUTES_SIZE must be a power of 2"
+#endif
+
+//Open addressing hash table with linear probing, size fixed at compile time
+static route_t routeTable[EDYHT_ROUTES_SIZE];
+
+static u32_t routeHash(const char *name){
+	u32_t hash = FNV_OFFSET;
+	while(*name) hash = hashStep(hash, *name++);
+	return hash;
+}
+
+static const route_t* routeFind(const char *name, u32_t hash){
+	unsigned int idx = hash & (EDYHT_ROUTES_SIZE - 1);
+	unsigned int n;
+
+	for(n = 0; n < EDYHT_ROUTES_SIZE; n++){
+		const route_t *route = &routeTable[idx];
+		if(route->name == NULL) return NULL;
+		if((route->hash == hash) && (strcmp(route->name, name) == 0)) return route;
+		idx = (idx + 1) & (EDYHT_ROUTES_SIZE - 1);
+	}
+	return NULL;
+}
+
+static int routeAdd(const route_t *newRoute){
+	unsigned int idx;
+	unsigned int n;
+
+	if(newRoute->name == NULL) return EDYHT_ERR_ARG;
+	if((unsigned int)newRoute->type >= sizeof(contentTypes)/sizeof(contentTypes[0])) return EDYHT_ERR_ARG;
+
+	idx = newRoute->hash & (EDYHT_ROUTES_SIZE - 1);
+	for(n = 0; n < EDYHT_ROUTES_SIZE; n++){
+		route_t *route = &routeTable[idx];
+		if(route->name == NULL){
+			*route = *newRoute;
+			route->metric = edyht_metrics_route(route->name);
+			return EDYHT_OK;
+		}
+		if((route->hash == newRoute->hash) && (strcmp(route->name, newRoute->name) == 0)){
+			return EDYHT_ERR_EXISTS;
+		}
+		idx = (idx + 1) & (EDYHT_ROUTES_SIZE - 1);
+	}
+	return EDYHT_ERR_FULL;
+}
+
+int edyht_register_static(const char *name, edyht_content_t type, const void *data, unsigned int len){
+	if(data == NULL) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = type, .data = data, .len = len };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+int edyht_register_handler(const char *name, edyht_content_t type, edyht_handler_t handler){
+	if(handler == NULL) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = type, .handler = handler };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+int edyht_register_handler_versioned(const char *name, edyht_content_t type, edyht_handler_t handler,
+		const volatile unsigned int *version){
+	if((handler == NULL) || (version == NULL) || (type == EDYHT_CONTENT_NONE)) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = type, .handler = handler, .version = version };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+int edyht_register_handler_cached(const char *name, edyht_content_t type, edyht_handler_t handler,
+		unsigned int ttl){
+	if((handler == NULL) || (type == EDYHT_CONTENT_NONE) || (ttl == 0)) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = type, .handler = handler, .ttl = ttl };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+int edyht_register_stream(const char *name, edyht_content_t type, edyht_provider_t provider,
+		const volatile unsigned int *version){
+	if((provider == NULL) || (type == EDYHT_CONTENT_NONE)) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = type, .version = version, .provider = provider };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+int edyht_register_array(const char *name, const edyht_array_t *array){
+	if((array == NULL) || (array->snap == NULL) || (array->type > EDYHT_ELEM_FLOAT32)) return EDYHT_ERR_ARG;
+	if((array->n == 0) || (array->n > array->snap->size / 4)) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = EDYHT_CONTENT_JSON, .array = array };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+int edyht_register_sse(const char *name, edyht_sse_t *topic){
+	if((topic == NULL) || (topic->vals == NULL) || (topic->stamps == NULL)) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = EDYHT_CONTENT_NONE, .sse = topic };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+int edyht_register_ws(const char *name, edyht_ws_handler_t handler){
+	if(handler == NULL) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = EDYHT_CONTENT_NONE, .wsHandler = handler };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+int edyht_register_form(const char *name, edyht_content_t type, edyht_form_field_t field, edyht_handler_t handler){
+	if((field == NULL) || (handler == NULL) || (type == EDYHT_CONTENT_NONE)) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = type, .handler = handler, .field = field };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+int edyht_register_upload(const char *name, edyht_content_t type, edyht_body_sink_t sink, edyht_handler_t handler){
+	if((sink == NULL) || (handler == NULL) || (type == EDYHT_CONTENT_NONE)) return EDYHT_ERR_ARG;
+	route_t route = { .name = name, .type = type, .handler = handler, .sink = sink };
+	if(name) route.hash = routeHash(name);
+	return routeAdd(&route);
+}
+
+//Renderers of the template placeholders, +1: no empty array without templates
+static edyht_handler_t slotRenderers[TPL_SLOT_COUNT + 1];
+
+static int slotFind(const char *name){
+	int i;
+	for(i = 0; i < TPL_SLOT_COUNT; i++){
+		if(strcmp(tplSlotNames[i], name) == 0) return i;
+	}
+	return -1;
+}
+
+int edyht_register_slot(const char *name, edyht_handler_t render){
+	int i;
+
+	if((name == NULL) || (render == NULL)) return EDYHT_ERR_ARG;
+	i = slotFind(name);
+	if(i < 0) return EDYHT_ERR_ARG;
+	slotRenderers[i] = render;
+	return EDYHT_OK;
+}
+
+static int tplRegister(const template_t *t){
+	route_t route = { .name = t->name, .hash = routeHash(t->name), .type = t->type, .tpl = t };
+	return routeAdd(&route);
+}
+
+int edyht_query_count(edyht_writer_t *w){
+	return w->req->queryCount;
+}
+
+const char* edyht_query_name(edyht_writer_t *w, int idx){
+	if((idx < 0) || (idx >= w->req->queryCount)) return NULL;
+	return w->req->query[idx].name;
+}
+
+const char* edyht_query_value(edyht_writer_t *w, int idx){
+	if((idx < 0) || (idx >= w->req->queryCount)) return NULL;
+	return w->req->query[idx].value;
+}
+
+const char* edyht_query_get(edyht_writer_t *w, const char *name){
+	const edyht_req_t *req = w->req;
+	int i;
+	for(i=0;i<req->queryCount;i++){
+		if(strcmp(req->query[i].name, name) == 0) return req->query[i].value;
+	}
+	return NULL;
+}
+
+static int assetRegister(const char *name, const asset_t *a){
+	route_t route = { .name = name, .hash = routeHash(name), .type = EDYHT_CONTENT_NONE,
+			.data = a->data, .len = a->hdrLen + a->len, .asset = a };
+	return routeAdd(&route);
+}
+
+//Body of an asset, e.g. begin and end of a dynamic page from htdocs/parts/
+static inline void assetWrite(edyht_writer_t *w, unsigned int id){
+	edyht_write_const(w, assets[id].data + assets[id].hdrLen, assets[id].len);
+}
+
+static void page_tasks(edyht_writer_t *w){
+	assetWrite(w, ASSET_parts_tasks_begin_htm);
+	/* Load dynamic page part */
+	edyht_tasks_html(w);
+	assetWrite(w, ASSET_parts_tasks_end_htm);
+}
+
+static void page_lwip(edyht_writer_t *w){
+	assetWrite(w, ASSET_parts_lwip_begin_htm);
+	/* Load dynamic page part */
+	edyht_lwipstats_html(w);
+	assetWrite(w, ASSET_parts_lwip_end_htm);
+}
+
+//Setpoint of the "regler" slider, initial value of testform.htm
+static char testformRegler[8] = "175";
+
+static void reglerSet(const char *value){
+	char *end;
+	long v = strtol(value, &end, 10);
+
+	if((end == value) || (*end != '\0') || (v < -100) || (v > 200)) return; //range of the slider
+	snprintf(testformRegler, sizeof(testformRegler), "%ld", v);
+}
+
+static void slot_regler(edyht_writer_t *w){
+	edyht_write(w, testformRegler, strlen(testformRegler));
+}
+
+//Live control of testform.htm: setpoint changes ("regler=<value>") are passed on to all open forms
+static void ws_testform(edyht_ws_t *ws, int binary, const void *data, unsigned int len){
+	LWIP_UNUSED_ARG(ws);
+	if(binary) return;
+	if(strncmp(data, "regler=", 7) == 0) reglerSet((const char*)data + 7);
+	edyht_ws_broadcast("testform.ws", 0, data, len);
+}
+
+//POST of testform.htm: fields are counted, a setpoint is passed on like ws_testform does
+static unsigned int testpostFields;
+
+static int form_testform(const char *name, const char *value){
+	char msg[32];
+	int n;
+
+	if(name == NULL){
+		testpostFields = 0; //incomplete body
+		return 0;
+	}
+	testpostFields++;
+	if(strcmp(name, "regler") == 0){
+		reglerSet(value);
+		n = snprintf(msg, sizeof(msg), "regler=%s", value);
+		if((n > 0) && (n < (int)sizeof(msg))) edyht_ws_broadcast("testform.ws", 0, msg, n);
+	}
+	return 1;
+}
+
+static void page_testpost(edyht_writer_t *w){
+	edyht_printf(w, "fields: %u\n", testpostFields);
+	testpostFields = 0;
+}
+
+//Upload test: length and FNV-1a hash of the body, e.g. curl --data-binary @file
+static u32_t uploadLen;
+static u32_t uploadHash;
+
+static int sink_testupload(unsigned int offset, const void *data, unsigned int len){
+	const char *d = data;
+
+	if(offset == 0) uploadHash = FNV_OFFSET;
+	if(data == NULL) return 0;
+	while(len--) uploadHash = hashStep(uploadHash, *d++);
+	uploadLen = offset + (d - (const char*)data);
+	return 1;
+}
+
+static void page_testupload(edyht_writer_t *w){
+	edyht_printf(w, "bytes: %lu, fnv: %08lx\n", (unsigned long)uploadLen, (unsigned long)uploadHash);
+	uploadLen = 0;
+	uploadHash = FNV_OFFSET;
+}
+
+static int stream_testjson(edyht_writer_t *w, unsigned int *cursor){
+	if(w == NULL) return arrayStream(w, cursor, EDYHT_FMT_JSON);
+	if(*cursor == 0) assetWrite(w, ASSET_parts_test_begin_json);
+	if(arrayStream(w, cursor, EDYHT_FMT_JSON)) return 1;
+	assetWrite(w, ASSET_parts_test_end_json);
+	return 0;
+}
+
+static int stream_testcsv(edyht_writer_t *w, unsigned int *cursor){
+	return arrayStream(w, cursor, EDYHT_FMT_CSV);
+}
+
+//Built-in pages, registered by edyht_init
+static const struct {
+	const char *name;
+	edyht_handler_t handler;
+	edyht_provider_t provider;
+	edyht_content_t type;
+	const volatile unsigned int *version;
+	unsigned int ttl;
+} builtinRoutes[] = {
+		{ "tasks.htm",    page_tasks,    NULL,            EDYHT_CONTENT_HTML, NULL, EDYHT_TASKS_TTL },
+		{ "tasks.json",   edyht_tasks_json, NULL,         EDYHT_CONTENT_JSON, NULL, EDYHT_TASKS_TTL },
+		{ "lwip.htm",     page_lwip,     NULL,            EDYHT_CONTENT_HTML, NULL, 0 },
+		{ "lwip.json",    edyht_lwipstats_json, NULL,     EDYHT_CONTENT_JSON, NULL, 0 },
+		{ "test.json",    NULL,          stream_testjson, EDYHT_CONTENT_JSON, &arraySnap.seq, 0 },
+		{ "test.csv",     NULL,          stream_testcsv,  EDYHT_CONTENT_CSV,  &arraySnap.seq, 0 },
+#if EDYHT_METRICS
+		{ "metrics",      edyht_metrics_prometheus, NULL, EDYHT_CONTENT_PLAIN, NULL, 0 },
+		{ "metrics.json", edyht_metrics_json,       NULL, EDYHT_CONTENT_JSON,  NULL, 0 },
+#endif
+};
+
+//Renderers of placeholders in htdocs/tpl/
+static const struct {
+	const char *name;
+	edyht_handler_t render;
+} builtinSlots[] = {
+		{ "query",  queryShow },
+		{ "regler", slot_regler },
+};
+
+static inline unsigned int assetSize(unsigned int id){
+	return assets[id].hdrLen + assets[id].len;
+}
+
+//Send prebuilt response of an asset, e.g. an error page
+static inline err_t assetSend(conn_t *conn, unsigned int id){
+	return blobSend(conn, assets[id].data, assetSize(id));
+}
+
+static inline void webpageBadProcess(conn_t *conn){
+	//improve: Add some html info
+	assetSend(conn, ASSET_err400_txt);
+}
+
+#ifndef EDYHT_ETAG_SALT
+#ifdef LWIP_RAND
+#define EDYHT_ETAG_SALT() LWIP_RAND()
+#else
+#define EDYHT_ETAG_SALT() sys_now()
+#endif
+#endif
+
+#define ETAG_LEN  24   //"\"xxxxxxxx-xxxxxxxx\"" + "0"
+
+static u32_t etagSalt; //per boot, for versioned dynamic pages
+
+//Header-only response for a matching If-None-Match, returns 1 if the connection stays open
+static int notModifiedSend(edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, u8_t keepAlive,
+		const char *etag, const blob_t *vary){
+	writerInit(w, conn, req, keepAlive);
+	edyht_write_const(w, http_304nm, http_304nm_len);
+	edyht_write_const(w, http_server, http_server_len);
+	if(!keepAlive && req->http11){
+		edyht_write_const(w, http_close, http_close_len);
+	}
+	edyht_printf(w, "ETag: %s\r\n", etag);
+	edyht_write_const(w, http_nocache, http_nocache_len);
+	if(vary != NULL){
+		edyht_write_const(w, vary->data, vary->len);
+	}
+	edyht_write_const(w, "\r\n", 2);
+	writerEnd(w);
+	return (w->err == ERR_OK) && keepAlive;
+}
+
+//Page from a template: static segments are sent zero-copy (or coalesced when small),
+//the slot renderers write in between
+static void tplRender(edyht_writer_t *w, const template_t *t){
+	const unsigned char *text = t->text;
+	unsigned int i;
+
+	for(i = 0; i < t->nSegs; i++){
+		const tplSeg_t *seg = &t->segs[i];
+		if(seg->len > 0) edyht_write_const(w, text, seg->len);
+		text += seg->len;
+		if((seg->slot != TPL_SLOT_NONE) && (slotRenderers[seg->slot] != NULL)) slotRenderers[seg->slot](w);
+	}
+}
+
+//Dynamic page from its handler, returns 1 if the connection stays open
+static int handlerServe(edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, u8_t keepAlive,
+		const route_t *route, const char *etag){
+	writerInit(w, conn, req, keepAlive);
+	if(route->type != EDYHT_CONTENT_NONE){
+		headerWrite(w, route->type, -1, etag, NULL);
+	}
+	route->handler(w);
+	writerEnd(w);
+	return (w->err == ERR_OK) && w->keepAlive;
+}
+
+#if EDYHT_CACHE_ENTRIES > 0
+
+/*
+ * Response cache: every entry owns a slot of EDYHT_CACHE_SLOT_LEN bytes with
+ * the normalized query ("name=value&..." sorted by name) followed by the
+ * complete response. The handler output is captured by the writer, the
+ * header with Content-Length is put in front of it afterwards. Hits are
+ * sent with a single copying write, a slot may be reused while lwIP still
+ * holds unacknowledged segments.
+ */
+
+#define CACHE_HDR_MAX  128     //room for the header in front of the body
+
+typedef struct {
+	const route_t *route;        //NULL: empty or being filled
+	u32_t key;                   //FNV-1a of route name and normalized query
+	u32_t expires;               //sys_now() at end of lifetime
+	u16_t queryLen;
+	u16_t start;                 //response in the slot
+	u16_t len;                   //0: response too large for a slot
+	u16_t split;                 //header up to Content-type, "Connection: close" is inserted here
+	u8_t users;                  //requests sending from the slot
+} cacheEntry_t;
+
+static cacheEntry_t cache[EDYHT_CACHE_ENTRIES];
+static u8_t cacheSlots[EDYHT_CACHE_ENTRIES][EDYHT_CACHE_SLOT_LEN];
+static unsigned int cacheGen;    //incremented by edyht_invalidate
+
+//Query element indices sorted by name and value
+static unsigned int queryOrder(const edyht_req_t *req, u8_t *idx){
+	unsigned int i, j;
+
+	for(i = 0; i < (unsigned int)req->queryCount; i++){
+		const edyht_query_t *q = &req->query[i];
+		for(j = i; j > 0; j--){
+			const edyht_query_t *p = &req->query[idx[j - 1]];
+			int c = strcmp(p->name, q->name);
+			if((c < 0) || ((c == 0) && (strcmp(p->value, q->value) <= 0))) break;
+			idx[j] = idx[j - 1];
+		}
+		idx[j] = i;
+	}
+	return i;
+}
+
+typedef struct {
+	u32_t hash;
+	unsigned int len;
+	char *dst;                   //store normalized query, NULL: hash only
+	unsigned int max;
+} queryNorm_t;
+
+static void queryNormPut(queryNorm_t *qn, const char *s){
+	while(*s){
+		qn->hash = hashStep(qn->hash, *s);
+		if((qn->dst != NULL) && (qn->len < qn->max)) qn->dst[qn->len] = *s;
+		qn->len++;
+		s++;
+	}
+}
+
+static void queryNormalize(queryNorm_t *qn, const edyht_req_t *req, const u8_t *idx, unsigned int n){
+	unsigned int i;
+	for(i = 0; i < n; i++){
+		if(i > 0) queryNormPut(qn, "&");
+		queryNormPut(qn, req->query[idx[i]].name);
+		queryNormPut(qn, "=");
+		queryNormPut(qn, req->query[idx[i]].value);
+	}
+}
+
+//Normalized query of the request equals s, both of the same length
+static int queryMatch(const u8_t *s, const edyht_req_t *req, const u8_t *idx, unsigned int n){
+	unsigned int i, l;
+	for(i = 0; i < n; i++){
+		const edyht_query_t *q = &req->query[idx[i]];
+		if((i > 0) && (*s++ != '&')) return 0;
+		l = strlen(q->name);
+		if(memcmp(s, q->name, l) != 0) return 0;
+		s += l;
+		if(*s++ != '=') return 0;
+		l = strlen(q->value);
+		if(memcmp(s, q->value, l) != 0) return 0;
+		s += l;
+	}
+	return 1;
+}
+
+static int cacheValid(const cacheEntry_t *e){
+	return (e->route != NULL) && ((s32_t)(e->expires - sys_now()) > 0);
+}
+
+//Valid entry for route and query, call with CACHE_LOCK
+static cacheEntry_t* cacheFind(const route_t *route, const queryNorm_t *qn,
+		const edyht_req_t *req, const u8_t *idx, unsigned int n){
+	unsigned int i;
+	for(i = 0; i < EDYHT_CACHE_ENTRIES; i++){
+		cacheEntry_t *e = &cache[i];
+		if((e->route == route) && (e->key == qn->hash) && (e->queryLen == qn->len) && cacheValid(e)
+				&& queryMatch(cacheSlots[i], req, idx, n)){
+			return e;
+		}
+	}
+	return NULL;
+}
+
+//Empty, expired or oldest entry not in use, call with CACHE_LOCK
+static cacheEntry_t* cacheAlloc(void){
+	cacheEntry_t *best = NULL;
+	unsigned int i;
+
+	for(i = 0; i < EDYHT_CACHE_ENTRIES; i++){
+		cacheEntry_t *e = &cache[i];
+		if(e->users > 0) continue;
+		if(!cacheValid(e)){
+			best = e;
+			break;
+		}
+		if((best == NULL) || ((s32_t)(e->expires - best->expires) < 0)) best = e;
+	}
+	if(best != NULL){
+		best->route = NULL;
+		best->users = 1;
+	}
+	return best;
+}
+
+static void cacheRelease(cacheEntry_t *e){
+	CACHE_LOCK();
+	e->users--;
+	CACHE_UNLOCK();
+}
+
+static void cacheSend(edyht_writer_t *w, const cacheEntry_t *e){
+	const u8_t *resp = &cacheSlots[e - cache][e->start];
+	unsigned int len = e->len;
+
+	if(w->head) len = e->split + contentTypes[e->route->type].len; //header only
+	if(!w->keepAlive && w->req->http11){
+		writerSend(w, resp, e->split, WRITE_COPY | WRITE_MORE);
+		writerSend(w, http_close, http_close_len, WRITE_NOCOPY | WRITE_MORE);
+		writerSend(w, resp + e->split, len - e->split, WRITE_COPY);
+	}
+	else{
+		writerSend(w, resp, len, WRITE_COPY);
+	}
+}
+
+//Handler output does not fit the cache slot: send the header and what was
+//captured so far, the rest goes directly to the connection. The length is
+//unknown, the response ends with the close.
+static void capSpill(edyht_writer_t *w){
+	const blob_t *type = &contentTypes[w->capType];
+	const u8_t *body = w->cap;
+
+	w->cap = NULL;
+	w->keepAlive = 0;
+	writerSend(w, http_200ok, http_200ok_len, WRITE_NOCOPY | WRITE_MORE);
+	writerSend(w, http_server, http_server_len, WRITE_NOCOPY | WRITE_MORE);
+	if(w->req->http11) writerSend(w, http_close, http_close_len, WRITE_NOCOPY | WRITE_MORE);
+	writerSend(w, type->data, type->len, WRITE_NOCOPY | WRITE_MORE);
+	if(w->head){
+		w->drop = 1; //header only
+		return;
+	}
+	writerSend(w, body, w->capLen, WRITE_COPY | WRITE_MORE);
+}
+
+//Handler output into the slot of e, returns 0 if it does not fit. The
+//response is then sent while the handler runs, see capSpill.
+static int cacheFill(edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, const route_t *route,
+		cacheEntry_t *e, unsigned int body){
+	u8_t *slot = cacheSlots[e - cache];
+	const blob_t *type = &contentTypes[route->type];
+	char hdr[CACHE_HDR_MAX];
+	unsigned int n;
+
+	writerInit(w, conn, req, 0);
+	w->cap = &slot[body];
+	w->capLen = 0;
+	w->capMax = EDYHT_CACHE_SLOT_LEN - body;
+	w->capType = route->type;
+	route->handler(w);
+	writerEnd(w);
+	if(w->cap == NULL) return 0;
+	w->cap = NULL;
+
+	memcpy(hdr, http_200ok, http_200ok_len);
+	n = http_200ok_len;
+	memcpy(&hdr[n], http_server, http_server_len);
+	n += http_server_len;
+	n += snprintf(&hdr[n], sizeof(hdr) - n, "Content-Length: %u\r\n", w->capLen);
+	e->split = n;
+	memcpy(&hdr[n], type->data, type->len);
+	n += type->len;
+
+	e->start = body - n;
+	e->len = n + w->capLen;
+	memcpy(&slot[e->start], hdr, n);
+	return 1;
+}
+
+static int cacheServe(edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, u8_t keepAlive,
+		const route_t *route){
+	u8_t idx[EDYHT_QUERY_MAX];
+	unsigned int n = queryOrder(req, idx);
+	queryNorm_t qn = { route->hash, 0, NULL, 0 };
+	cacheEntry_t *e;
+	unsigned int gen;
+	int ok;
+
+	queryNormalize(&qn, req, idx, n);
+
+	CACHE_LOCK();
+	e = cacheFind(route, &qn, req, idx, n);
+	if(e != NULL){
+		e->users++;
+	}
+	else if(qn.len + CACHE_HDR_MAX < EDYHT_CACHE_SLOT_LEN){
+		e = cacheAlloc();
+	}
+	gen = cacheGen;
+	CACHE_UNLOCK();
+
+	if((e != NULL) && (e->route != NULL) && (e->len > 0)){
+		edyht_metrics_count(EDYHT_METRIC_CACHE_HIT);
+		writerInit(w, conn, req, keepAlive);
+		cacheSend(w, e);
+		cacheRelease(e);
+		return (w->err == ERR_OK) && keepAlive;
+	}
+	edyht_metrics_count(EDYHT_METRIC_CACHE_MISS);
+	if((e == NULL) || (e->route != NULL)){
+		//no free entry, query too long or response known to be too large
+		if(e != NULL) cacheRelease(e);
+		return handlerServe(w, conn, req, keepAlive, route, NULL);
+	}
+
+	qn.hash = route->hash;
+	qn.len = 0;
+	qn.dst = (char*)cacheSlots[e - cache];
+	qn.max = EDYHT_CACHE_SLOT_LEN;
+	queryNormalize(&qn, req, idx, n);
+	ok = cacheFill(w, conn, req, route, e, qn.len + CACHE_HDR_MAX);
+
+	CACHE_LOCK();
+	e->route = route;
+	e->key = qn.hash;
+	e->queryLen = qn.len;
+	if(!ok) e->len = 0;
+	//changed during the handler call: only used for this request
+	e->expires = sys_now() + ((gen == cacheGen) ? route->ttl : 0);
+	CACHE_UNLOCK();
+
+	if(!ok){
+		//already sent by capSpill, connection is closed
+		cacheRelease(e);
+		return 0;
+	}
+	writerInit(w, conn, req, keepAlive);
+	cacheSend(w, e);
+	cacheRelease(e);
+	return (w->err == ERR_OK) && keepAlive;
+}
+
+#endif //EDYHT_CACHE_ENTRIES
+
+//Streaming page or event stream in progress
+typedef struct {
+	edyht_provider_t provider;   //NULL: no streaming page pending
+	const edyht_array_t *array;  //array endpoint: text formats in progress, binary: snapshot referenced by lwIP
+	edyht_sse_t *sse;            //NULL: no event stream
+	unsigned int cursor;         //event streams: number of events sent, array endpoints: next value
+	unsigned int seen;           //event streams: last version sent
+	u32_t last;                  //event streams: sys_now() of last event
+	u8_t keepAlive;
+	u8_t chunked;
+	u8_t metric;                 //counter slot of the route
+	u8_t fmt;                    //array endpoints: edyht_fmt_t
+	u8_t held;                   //array endpoints: snapshot buffer
+} stream_t;
+
+static inline int streamPending(const stream_t *s){
+	return (s->provider != NULL) || (s->array != NULL) || (s->sse != NULL);
+}
+
+static void arrayRelease(stream_t *s){
+	edyht_snap_release(s->array->snap, s->held);
+	s->array = NULL;
+}
+
+//Binary array sent zero-copy, the snapshot is released when lwIP no longer references it
+static inline int arrayAckPending(const stream_t *s){
+	return (s->array != NULL) && edyht_fmt_binary(s->fmt);
+}
+
+//Text formats of an array endpoint, returns 1 while more follows
+static int arrayStep(edyht_writer_t *w, stream_t *s){
+	const edyht_array_t *a = s->array;
+	const void *vals = edyht_snap_data(a->snap, s->held);
+
+	switch(a->type){
+	case EDYHT_ELEM_INT32:
+		if(a->frac > 0) s->cursor = edyht_write_fix_array_part(w, vals, a->n, s->cursor, a->frac, s->fmt);
+		else s->cursor = edyht_write_int_array_part(w, vals, a->n, s->cursor, s->fmt);
+		break;
+	case EDYHT_ELEM_UINT32:
+		s->cursor = edyht_write_uint_array_part(w, vals, a->n, s->cursor, s->fmt);
+		break;
+	case EDYHT_ELEM_FLOAT32:
+		s->cursor = edyht_write_float_array_part(w, vals, a->n, s->cursor, a->frac, s->fmt);
+		break;
+	}
+	if(s->cursor < a->n) return 1;
+	if(s->fmt == EDYHT_FMT_JSON) edyht_write_const(w, "]", 1);
+	arrayRelease(s);
+	return 0;
+}
+
+//Streaming page aborted, release what the provider / array endpoint holds
+static void streamAbort(stream_t *s){
+	if(s->provider != NULL) s->provider(NULL, &s->cursor);
+	if(s->array != NULL) arrayRelease(s);
+	s->provider = NULL;
+}
+
+//Next part of a streaming page as one chunk, returns 1 while more follows
+static int streamStep(edyht_writer_t *w, stream_t *s){
+	int more = (s->array != NULL) ? arrayStep(w, s) : s->provider(w, &s->cursor);
+
+	if(more && (w->err == ERR_OK)){
+		if(w->chunked) chunkClose(w);
+		writerSendBuf(w, WRITE_MORE);
+		return 1;
+	}
+	if(more) streamAbort(s);
+	s->provider = NULL;
+	writerEnd(w);
+	return 0;
+}
+
+//Next event of an event stream, returns 1 if anything was written
+static int sseStep(edyht_writer_t *w, stream_t *s){
+	edyht_sse_t *t = s->sse;
+	u32_t now = sys_now();
+
+	if(s->cursor == 0){
+		//new subscriber: all values
+		edyht_sse_write(w, t, &s->seen, 1);
+	}
+	else if((u32_t)(now - s->last) < t->interval){
+		return 0; //rate limit, changes are accumulated until the next event
+	}
+	else if((t->version == s->seen) || !edyht_sse_write(w, t, &s->seen, 0)){
+		if((u32_t)(now - s->last) < EDYHT_SSE_HEARTBEAT) return 0;
+		edyht_write_const(w, ":\n\n", 3); //comment, write fails if the client is gone
+	}
+	s->cursor++;
+	s->last = now;
+	return 1;
+}
+
+//Start an event stream, the connection is closed when it ends. HEAD: header only.
+static void sseBegin(edyht_writer_t *w, stream_t *s, edyht_sse_t *t){
+	edyht_write_const(w, http_200ok, http_200ok_len);
+	edyht_write_const(w, http_server, http_server_len);
+	edyht_write_const(w, http_nocache, http_nocache_len);
+	edyht_write_const(w, http_content_events, http_content_events_len);
+	s->provider = NULL;
+	if(w->head){
+		writerSendBuf(w, 0);
+		s->sse = NULL;
+		return;
+	}
+	s->sse = t;
+	s->cursor = 0;
+	s->keepAlive = 0;
+	s->chunked = 0;
+	sseStep(w, s);
+	writerSendBuf(w, 0);
+}
+
+struct edyht_ws {
+	conn_t *conn;
+	const route_t *route;        //NULL: no (longer a) WebSocket connection
+	edyht_ws_rx_t rx;
+	u32_t lastRx;                //sys_now() of the last received data
+	u8_t pingSent;
+	u8_t failed;                 //a frame was not (completely) sent, the connection is closed
+#if !EDYHT_RAW_API
+	sys_mutex_t lock;            //route, failed and frames of this connection
+#endif
+};
+
+//Send one frame, ERR_CLSD if the connection is no WebSocket (any more).
+//A failed write, e.g. after EDYHT_WS_SEND_TIMEOUT, may have left part of the
+//frame, no further frames are sent and the connection is closed by its task.
+static err_t wsFrameSend(edyht_ws_t *ws, u8_t opcode, const void *data, unsigned int len){
+	u8_t hdr[EDYHT_WS_HDR_MAX];
+	unsigned int n = edyht_ws_header(hdr, opcode, len);
+	err_t err = ERR_CLSD;
+
+	WS_LOCK(ws);
+	if((ws->route != NULL) && !ws->failed){
+		err = connWrite(ws->conn, hdr, n, WRITE_COPY | ((len > 0) ? WRITE_MORE : 0));
+		if((err == ERR_OK) && (len > 0)) err = connWrite(ws->conn, data, len, WRITE_COPY);
+		if(err == ERR_OK){
+			connPush(ws->conn);
+			edyht_metrics_bytes(ws->route->metric, n + len);
+		}
+		else{
+			ws->failed = 1;
+		}
+	}
+	WS_UNLOCK(ws);
+	return err;
+}
+
+static void wsClose(edyht_ws_t *ws, unsigned int status){
+	u8_t payload[2] = { status >> 8, status & 0xff };
+	wsFrameSend(ws, EDYHT_WS_OP_CLOSE, payload, 2);
+}
+
+//Connection is about to be closed, no more frames
+static void wsEnd(edyht_ws_t *ws){
+	WS_LOCK(ws);
+	ws->route = NULL;
+	WS_UNLOCK(ws);
+}
+
+static int wsRequestValid(const edyht_req_t *req){
+	const char *version = req->hdr[EDYHT_HDR_WS_VERSION];
+
+	return req->http11 && (req->hdr[EDYHT_HDR_WS_KEY] != NULL) && (version != NULL) && (strcmp(version, "13") == 0)
+			&& edyht_parse_accepts(req->hdr[EDYHT_HDR_CONNECTION], "upgrade")
+			&& edyht_parse_accepts(req->hdr[EDYHT_HDR_UPGRADE], "websocket");
+}
+
+//Upgrade handshake of a valid request, returns 1 if the connection continues as WebSocket
+static int wsOpen(edyht_ws_t *ws, edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, const route_t *route){
+	char accept[EDYHT_WS_ACCEPT_LEN + 1];
+
+	edyht_ws_accept(req->hdr[EDYHT_HDR_WS_KEY], accept);
+	writerInit(w, conn, req, 0);
+	edyht_write_const(w, http_101ws, http_101ws_len);
+	edyht_write_const(w, http_server, http_server_len);
+	edyht_printf(w, "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+	writerEnd(w);
+	if(w->err != ERR_OK) return 0;
+
+	connNoDelay(conn); //small frames, answers must not wait for ACKs
+#if !EDYHT_RAW_API && LWIP_SO_SNDTIMEO
+	netconn_set_sendtimeout(conn, EDYHT_WS_SEND_TIMEOUT); //a stalled client must not block senders
+#endif
+	edyht_ws_rx_init(&ws->rx);
+	ws->conn = conn;
+	ws->lastRx = sys_now();
+	ws->pingSent = 0;
+	WS_LOCK(ws);
+	ws->failed = 0;
+	ws->route = route;
+	WS_UNLOCK(ws);
+	return 1;
+}
+
+//Received data of a WebSocket connection, returns 0 if the connection is to be closed
+static int wsReceive(edyht_ws_t *ws, const u8_t *data, unsigned int len){
+	if(ws->failed) return 0;
+	ws->lastRx = sys_now();
+	ws->pingSent = 0;
+
+	while(len > 0){
+		edyht_ws_frame_t f;
+		unsigned int used;
+		int ret = edyht_ws_rx(&ws->rx, data, len, &used, &f);
+
+		data += used;
+		len -= used;
+		if(ret < 0){
+			wsClose(ws, (ret == EDYHT_WS_RX_ERR_SIZE) ? 1009 : 1002);
+			return 0;
+		}
+		if(ret != EDYHT_WS_RX_FRAME) continue;
+
+		switch(f.opcode){
+		case EDYHT_WS_OP_PING:
+			wsFrameSend(ws, EDYHT_WS_OP_PONG, f.data, f.len);
+			break;
+		case EDYHT_WS_OP_PONG:
+			break;
+		case EDYHT_WS_OP_CLOSE:
+			//echo status code, then close
+			wsFrameSend(ws, EDYHT_WS_OP_CLOSE, f.data, (f.len >= 2) ? 2 : 0);
+			return 0;
+		default:
+			ws->route->wsHandler(ws, f.opcode == EDYHT_WS_OP_BINARY, f.data, f.len);
+			break;
+		}
+	}
+	return 1;
+}
+
+//No data for EDYHT_WS_PING ms: ping once, returns 0 if the previous ping was not answered
+static int wsIdle(edyht_ws_t *ws){
+	if(ws->pingSent || ws->failed) return 0;
+	ws->pingSent = 1;
+	return wsFrameSend(ws, EDYHT_WS_OP_PING, NULL, 0) == ERR_OK;
+}
+
+int edyht_ws_send(edyht_ws_t *ws, int binary, const void *data, unsigned int len){
+	if(ws == NULL) return EDYHT_ERR_ARG;
+	if(wsFrameSend(ws, binary ? EDYHT_WS_OP_BINARY : EDYHT_WS_OP_TEXT, data, len) != ERR_OK) return EDYHT_ERR_CONN;
+	return EDYHT_OK;
+}
+
+//POST body being received, see edyht_register_form / edyht_register_upload
+typedef struct {
+	const route_t *route;        //NULL: no body pending
+	u32_t left;                  //bytes still to receive
+	u32_t offset;                //bytes received
+	u32_t start;                 //EDYHT_METRICS_CLOCK() at the end of the header
+	u8_t keepAlive;
+	edyht_form_t form;
+} body_t;
+
+//Body ended incomplete or failed, the application may drop what it has
+static void bodyAbort(body_t *b){
+	if(b->route == NULL) return;
+	if(b->route->field != NULL) b->route->field(NULL, NULL);
+	else b->route->sink(b->offset, NULL, 0);
+	b->route = NULL;
+}
+
+//Prepare writer for the next part
+static void streamResume(edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, const stream_t *s){
+	writerInit(w, conn, req, s->keepAlive);
+	w->chunked = s->chunked;
+	w->drop = w->head; //header already sent
+	if(w->chunked) chunkOpen(w);
+}
+
+//Outcome of a request for the metrics
+typedef struct {
+	u8_t metric;                 //counter slot of the route
+	u16_t status;
+	u32_t bytes;                 //sent without writer (prebuilt responses)
+} reqStat_t;
+
+//Send the streaming page set up in stream after its header, returns 1 if the connection stays open
+static int streamStart(edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, u8_t keepAlive,
+		stream_t *stream, u8_t metric){
+	stream->keepAlive = keepAlive;
+	stream->chunked = w->chunked;
+	stream->metric = metric;
+#if EDYHT_RAW_API
+	LWIP_UNUSED_ARG(conn);
+	LWIP_UNUSED_ARG(req);
+	//continued by rawService when lwIP took this part
+	if(streamStep(w, stream)) return 1;
+#else
+	while(streamStep(w, stream)){
+		streamResume(w, conn, req, stream);
+	}
+#endif
+	return (w->err == ERR_OK) && keepAlive;
+}
+
+//Format of an array endpoint: query "fmt", else the first of JSON, CBOR,
+//raw and CSV the Accept header allows. *vary is set if Accept decided.
+static edyht_fmt_t arrayFormat(const edyht_req_t *req, u8_t *vary){
+	static const char * const names[] = {
+			[EDYHT_FMT_JSON] = "json",
+			[EDYHT_FMT_CSV]  = "csv",
+			[EDYHT_FMT_CBOR] = "cbor",
+			[EDYHT_FMT_RAW]  = "raw",
+	};
+	static const char * const types[] = {
+			[EDYHT_FMT_JSON] = "application/json",
+			[EDYHT_FMT_CSV]  = "text/csv",
+			[EDYHT_FMT_CBOR] = "application/cbor",
+			[EDYHT_FMT_RAW]  = "application/octet-stream",
+	};
+	static const u8_t acceptOrder[] = { EDYHT_FMT_JSON, EDYHT_FMT_CBOR, EDYHT_FMT_RAW, EDYHT_FMT_CSV };
+	const char *accept = req->hdr[EDYHT_HDR_ACCEPT];
+	unsigned int i, n;
+#if BYTE_ORDER == BIG_ENDIAN
+	n = EDYHT_FMT_CBOR; //values are sent as they are in memory
+#else
+	n = sizeof(names)/sizeof(names[0]);
+#endif
+
+	*vary = 0;
+	for(i = 0; i < (unsigned int)req->queryCount; i++){
+		if(strcmp(req->query[i].name, "fmt") == 0){
+			unsigned int f;
+			for(f = 0; f < n; f++){
+				if(strcmp(req->query[i].value, names[f]) == 0) return f;
+			}
+			return EDYHT_FMT_JSON;
+		}
+	}
+	*vary = 1;
+	for(i = 0; i < sizeof(acceptOrder); i++){
+		if((acceptOrder[i] < n) && edyht_parse_accepts(accept, types[acceptOrder[i]])) return acceptOrder[i];
+	}
+	return EDYHT_FMT_JSON;
+}
+
+//Latest data of an array endpoint, returns 1 if the connection stays open
+static int arrayServe(edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, u8_t keepAlive,
+		const route_t *route, stream_t *stream, reqStat_t *st){
+	static const edyht_content_t fmtTypes[] = {
+			[EDYHT_FMT_JSON] = EDYHT_CONTENT_JSON,
+			[EDYHT_FMT_CSV]  = EDYHT_CONTENT_CSV,
+			[EDYHT_FMT_CBOR] = EDYHT_CONTENT_CBOR,
+			[EDYHT_FMT_RAW]  = EDYHT_CONTENT_BINARY,
+	};
+	const edyht_array_t *a = route->array;
+	u8_t vary;
+	edyht_fmt_t fmt = arrayFormat(req, &vary);
+	const blob_t *varyHdr = vary ? &varyAccept : NULL;
+	char etag[ETAG_LEN];
+
+	snprintf(etag, sizeof(etag), "\"%08lx-%lx-%c\"", (unsigned long)etagSalt, (unsigned long)a->snap->seq, "jcbr"[fmt]);
+	if(edyht_parse_etag_match(req->hdr[EDYHT_HDR_IF_NONE_MATCH], etag)){
+		st->status = 304;
+		return notModifiedSend(w, conn, req, keepAlive, etag, varyHdr);
+	}
+
+	writerInit(w, conn, req, keepAlive);
+	stream->array = a;
+	stream->fmt = fmt;
+	stream->held = edyht_snap_hold(a->snap);
+	if(edyht_fmt_binary(fmt)){
+		unsigned char hdr[EDYHT_FMT_BIN_HDR];
+		unsigned int hdrLen = edyht_fmt_array_header(hdr, fmt, a->type, a->n);
+
+		headerWrite(w, fmtTypes[fmt], hdrLen + a->n * 4, etag, varyHdr);
+		edyht_write(w, hdr, hdrLen);
+		writerSendBuf(w, WRITE_MORE);
+#if EDYHT_RAW_API
+		//zero-copy, released by rawStream when all data is acknowledged
+		writerSend(w, edyht_snap_data(a->snap, stream->held), a->n * 4, WRITE_NOCOPY);
+		stream->keepAlive = keepAlive;
+#else
+		//netconn does not tell when lwIP released the data, copy
+		writerSend(w, edyht_snap_data(a->snap, stream->held), a->n * 4, WRITE_COPY);
+		arrayRelease(stream);
+#endif
+		return (w->err == ERR_OK) && keepAlive;
+	}
+	headerWrite(w, fmtTypes[fmt], -1, etag, varyHdr);
+	if(fmt == EDYHT_FMT_JSON) edyht_write_const(w, "[", 1);
+	stream->cursor = 0;
+	return streamStart(w, conn, req, keepAlive, stream, route->metric);
+}
+
+static int badRequestSend(conn_t *conn, reqStat_t *st){
+	webpageBadProcess(conn);
+	st->status = 400;
+	st->bytes = assetSize(ASSET_err400_txt);
+	return 0;
+}
+
+//POST endpoint: check the header, the body is passed to bodyProcess as it arrives
+static int postBegin(conn_t *conn, const edyht_req_t *req, u8_t keepAlive, const route_t *route,
+		body_t *body, reqStat_t *st){
+	const char *len = req->hdr[EDYHT_HDR_CONTENT_LENGTH];
+	u32_t n = 0;
+
+	if((req->method != EDYHT_METHOD_POST) || (len == NULL) || (*len < '0') || (*len > '9')
+			|| (req->hdr[EDYHT_HDR_TRANSFER_ENCODING] != NULL)){
+		return badRequestSend(conn, st);
+	}
+	//digits only, a length beyond 32 bit is rejected instead of wrapping
+	for(; (*len >= '0') && (*len <= '9'); len++){
+		if(n > (0xffffffffUL - (u32_t)(*len - '0')) / 10) return badRequestSend(conn, st);
+		n = n * 10 + (*len - '0');
+	}
+	if(*len != '\0') return badRequestSend(conn, st);
+	//media type with optional parameters, same syntax as an Accept element
+	if((route->field != NULL)
+			&& !edyht_parse_accepts(req->hdr[EDYHT_HDR_CONTENT_TYPE], "application/x-www-form-urlencoded")){
+		return badRequestSend(conn, st);
+	}
+
+	if((n > 0) && req->http11 && edyht_parse_accepts(req->hdr[EDYHT_HDR_EXPECT], "100-continue")){
+		if(blobSend(conn, http_100cont, http_100cont_len) != ERR_OK) return 0;
+	}
+	body->route = route;
+	body->left = n;
+	body->offset = 0;
+	body->keepAlive = keepAlive;
+	if(route->field != NULL) edyht_form_init(&body->form, route->field);
+	return 1;
+}
+
+//Received data of a pending POST body, *used returns the bytes that belong to it.
+//After the last byte the response is sent and body->route is NULL again.
+//Returns 1 if the connection stays open.
+static int bodyProcess(edyht_writer_t *w, conn_t *conn, const edyht_req_t *req, body_t *b,
+		const char *data, unsigned int len, unsigned int *used){
+	const route_t *route = b->route;
+	reqStat_t st = { route->metric, 200, 0 };
+	int ret = EDYHT_FORM_OK;
+	int open;
+
+	if(len > b->left) len = b->left;
+	*used = len;
+	if(route->field != NULL){
+		ret = edyht_form_feed(&b->form, data, len);
+	}
+	else if((len > 0) && !route->sink(b->offset, data, len)){
+		ret = EDYHT_FORM_ERR_REJECT;
+	}
+	b->offset += len;
+	b->left -= len;
+	if((ret == EDYHT_FORM_OK) && (b->left > 0)) return 1;
+	if((ret == EDYHT_FORM_OK) && (route->field != NULL)) ret = edyht_form_end(&b->form);
+
+	w->sent = 0;
+	if(ret == EDYHT_FORM_OK){
+		b->route = NULL;
+		open = handlerServe(w, conn, req, b->keepAlive, route, NULL);
+	}
+	else{
+		bodyAbort(b);
+		open = badRequestSend(conn, &st);
+	}
+#if EDYHT_METRICS
+	edyht_metrics_request(st.metric, st.status, st.bytes + w->sent, EDYHT_METRICS_CLOCK() - b->start);
+#endif
+	return open;
+}
+
+//1 if the request has a body, only POST routes read it
+static int bodyPresent(const edyht_req_t *req){
+	const char *len = req->hdr[EDYHT_HDR_CONTENT_LENGTH];
+
+	if(req->hdr[EDYHT_HDR_TRANSFER_ENCODING] != NULL) return 1;
+	if(len == NULL) return 0;
+	while(*len == '0') len++;
+	return *len != '\0';
+}
+
+static int pageServe(const edyht_req_t *req, edyht_writer_t *w, conn_t *conn, u8_t keepAlive,
+		stream_t *stream, edyht_ws_t *ws, body_t *body, reqStat_t *st){
+
+	const route_t *route;
+	const char *ifNoneMatch = req->hdr[EDYHT_HDR_IF_NONE_MATCH];
+	char etag[ETAG_LEN];
+
+	st->status = 200;
+	if(req->method == EDYHT_METHOD_OTHER){
+		st->status = 501;
+		st->bytes = assetSize(ASSET_err501_txt);
+		assetSend(conn, ASSET_err501_txt);
+		return 0;
+	}
+
+	route = routeFind(req->path, req->pathHash);
+	if(((route == NULL) || ((route->field == NULL) && (route->sink == NULL))) && bodyPresent(req)){
+		//unread body, would be taken for the next request
+		keepAlive = 0;
+	}
+	if(route == NULL)
+	{
+		/* Show error page, header only for HEAD */
+		st->status = 404;
+		st->bytes = (req->method == EDYHT_METHOD_HEAD) ? assets[ASSET_err404_htm].hdrLen : assetSize(ASSET_err404_htm);
+		return (blobSend(conn, assets[ASSET_err404_htm].data, st->bytes) == ERR_OK) && keepAlive;
+	}
+
+	st->metric = route->metric;
+	if((route->field != NULL) || (route->sink != NULL))
+	{
+		return postBegin(conn, req, keepAlive, route, body, st);
+	}
+	else if(req->method == EDYHT_METHOD_POST)
+	{
+		return badRequestSend(conn, st);
+	}
+	else if(route->sse != NULL)
+	{
+		//continued by sseRun / rawSseTick
+		writerInit(w, conn, req, 0);
+		sseBegin(w, stream, route->sse);
+		stream->metric = route->metric;
+		if((w->err == ERR_OK) && (stream->sse != NULL)) return 1;
+		stream->sse = NULL;
+		return 0;
+	}
+	else if(route->wsHandler != NULL)
+	{
+		if((req->method != EDYHT_METHOD_GET) || !wsRequestValid(req) || bodyPresent(req)){
+			return badRequestSend(conn, st);
+		}
+		st->status = 101;
+		return wsOpen(ws, w, conn, req, route);
+	}
+	else if(route->array != NULL)
+	{
+		return arrayServe(w, conn, req, keepAlive, route, stream, st);
+	}
+	else if((route->handler == NULL) && (route->type == EDYHT_CONTENT_NONE))
+	{
+		const asset_t *a = route->asset;
+		if(a != NULL){
+			u8_t gz = (a->gz != NULL) && edyht_parse_accepts(req->hdr[EDYHT_HDR_ACCEPT_ENCODING], "gzip");
+			if(ifNoneMatch != NULL){
+				//ETag as generated by mkassets
+				snprintf(etag, sizeof(etag), gz ? "\"%08lx-gz\"" : "\"%08lx\"", (unsigned long)a->hash);
+				if(edyht_parse_etag_match(ifNoneMatch, etag)){
+					st->status = 304;
+					return notModifiedSend(w, conn, req, keepAlive, etag, (a->gz != NULL) ? &varyEncoding : NULL);
+				}
+			}
+			if(gz){
+				//compressed at build time
+				st->bytes = (req->method == EDYHT_METHOD_HEAD) ? a->gzHdrLen : a->gzHdrLen + a->gzLen;
+				return (blobSend(conn, a->gz, st->bytes) == ERR_OK) && keepAlive;
+			}
+		}
+		//prebuilt response with Content-Length
+		st->bytes = route->len;
+		if(req->method == EDYHT_METHOD_HEAD){
+			if(a != NULL) st->bytes = a->hdrLen;
+			else keepAlive = 0; //header length unknown, end of response is the close
+		}
+		return (blobSend(conn, route->data, st->bytes) == ERR_OK) && keepAlive;
+	}
+	else
+	{
+		const char *etagHdr = NULL;
+
+		if(route->version != NULL){
+			snprintf(etag, sizeof(etag), "\"%08lx-%lx\"", (unsigned long)etagSalt, (unsigned long)*route->version);
+			if(edyht_parse_etag_match(ifNoneMatch, etag)){
+				st->status = 304;
+				return notModifiedSend(w, conn, req, keepAlive, etag, NULL);
+			}
+			etagHdr = etag;
+		}
+		if(route->handler != NULL){
+			if(route->type == EDYHT_CONTENT_NONE){
+				keepAlive = 0; //end of response unknown, close connection
+			}
+#if EDYHT_CACHE_ENTRIES > 0
+			if(route->ttl > 0) return cacheServe(w, conn, req, keepAlive, route);
+#endif
+			return handlerServe(w, conn, req, keepAlive, route, etagHdr);
+		}
+		writerInit(w, conn, req, keepAlive);
+		if(route->tpl != NULL){
+			headerWrite(w, route->type, -1, NULL, NULL);
+			tplRender(w, route->tpl);
+			writerEnd(w);
+			return (w->err == ERR_OK) && w->keepAlive;
+		}
+		if(route->provider != NULL){
+			headerWrite(w, route->type, -1, etagHdr, NULL);
+			stream->provider = route->provider;
+			stream->cursor = 0;
+			return streamStart(w, conn, req, keepAlive, stream, route->metric);
+		}
+		headerWrite(w, route->type, route->len, NULL, NULL);
+		edyht_write_const(w, route->data, route->len);
+		writerEnd(w);
+		return (w->err == ERR_OK) && w->keepAlive;
+	}
+}
+
+//Returns 1 if the connection can be kept open for further requests. A
+//streaming page (EDYHT_RAW_API), an event stream or a POST body may still be pending.
+static int webpageProcess(const edyht_req_t *req, edyht_writer_t *w, conn_t *conn, u8_t keepAlive,
+		stream_t *stream, edyht_ws_t *ws, body_t *body){
+	reqStat_t st = { EDYHT_METRICS_OTHER, 0, 0 };
+	unsigned int used;
+	int ret;
+#if EDYHT_METRICS
+	u32_t start = EDYHT_METRICS_CLOCK();
+
+	w->sent = 0;
+	body->start = start;
+#endif
+	ret = pageServe(req, w, conn, keepAlive, stream, ws, body, &st);
+	if(body->route != NULL){
+		//counted by bodyProcess after the body
+		if(body->left == 0) ret = bodyProcess(w, conn, req, body, NULL, 0, &used);
+		return ret;
+	}
+#if EDYHT_METRICS
+	edyht_metrics_request(st.metric, st.status, st.bytes + w->sent, EDYHT_METRICS_CLOCK() - start);
+#endif
+	return ret;
+}
+
+//Keep the connection open after this request? Also ends it after EDYHT_CONN_BUDGET.
+static u8_t keepAliveCheck(const edyht_req_t *req, int requests, u32_t start){
+	if(!req->keepAlive || (requests >= EDYHT_KEEPALIVE_MAX)) return 0;
+#if EDYHT_CONN_BUDGET > 0
+	if((u32_t)(sys_now() - start) >= EDYHT_CONN_BUDGET){
+		edyht_metrics_count(EDYHT_METRIC_BUDGET);
+		return 0;
+	}
+#else
+	LWIP_UNUSED_ARG(start);
+#endif
+	return 1;
+}
+
+//Over EDYHT_MAX_CONNS, the prebuilt 503 has been handed to the stack
+static inline void rejectCount(void){
+	edyht_metrics_count(EDYHT_METRIC_REJECTED);
+	edyht_metrics_request(EDYHT_METRICS_OTHER, 503, assetSize(ASSET_err503_txt), 0);
+}
+
+#if !EDYHT_RAW_API
+
+//Per-connection state, one per worker
+typedef struct {
+	edyht_req_t parse;
+	edyht_writer_t w;
+	stream_t stream;
+	edyht_ws_t ws;
+	body_t body;
+	u32_t start;             //sys_now() when the worker took the connection
+	u32_t reqStart;          //sys_now() at the first byte of the current request
+} httpCtx_t;
+
+//Event stream, runs until the client is gone
+static void sseRun(edyht_writer_t *w, stream_t *s){
+	while(w->err == ERR_OK){
+		w->sent = 0;
+		if(sseStep(w, s)){
+			writerSendBuf(w, 0);
+			edyht_metrics_bytes(s->metric, w->sent);
+		}
+		else{
+			sys_msleep(EDYHT_SSE_TICK);
+		}
+	}
+	s->sse = NULL;
+}
+
+//Receive timeout for the next netconn_recv, 0: a deadline has already
+//passed. *reason is the event counted when it expires.
+static u32_t recvTimeout(const httpCtx_t *ctx, int requests, u8_t *reason){
+	u32_t now = sys_now();
+	u32_t timeout, used;
+
+	*reason = EDYHT_METRIC_TIMEOUT;
+	if(ctx->ws.route != NULL) return EDYHT_WS_PING;
+
+	if(ctx->body.route != NULL){
+		timeout = EDYHT_RECV_TIMEOUT;
+	}
+	else if((requests > 0) && edyht_parse_idle(&ctx->parse)){
+		timeout = EDYHT_KEEPALIVE_TIMEOUT; //idle between requests
+	}
+	else{
+		*reason = EDYHT_METRIC_HEADER_TIMEOUT;
+		used = now - ctx->reqStart;
+		if(used >= EDYHT_HEADER_TIMEOUT) return 0;
+		timeout = EDYHT_HEADER_TIMEOUT - used;
+	}
+#if EDYHT_CONN_BUDGET > 0
+	used = now - ctx->start;
+	if(used >= EDYHT_CONN_BUDGET){
+		*reason = EDYHT_METRIC_BUDGET;
+		return 0;
+	}
+	if(EDYHT_CONN_BUDGET - used < timeout){
+		*reason = EDYHT_METRIC_BUDGET;
+		timeout = EDYHT_CONN_BUDGET - used;
+	}
+#endif
+	return timeout;
+}
+
+static void serve_get_request(httpCtx_t *ctx, struct netconn *conn)
+{
+	struct netbuf *inbuf;
+	err_t recv_err;
+	char* buf;
+	u16_t buflen;
+	int doexit = 0;
+	int requests = 0;
+	u8_t reason;
+
+	edyht_parse_init(&ctx->parse);
+	ctx->start = sys_now();
+	ctx->reqStart = ctx->start;
+
+	do{
+		//Set timeout: header deadline, body / keep-alive timeout, connection budget
+		u32_t timeout = recvTimeout(ctx, requests, &reason);
+		if(timeout == 0){
+			edyht_metrics_count(reason);
+			break;
+		}
+		netconn_set_recvtimeout(conn, timeout);
+
+		// Receive data
+		recv_err = netconn_recv(conn, &inbuf);
+
+		if (recv_err == ERR_OK)	{
+			if (netconn_err(conn) == ERR_OK) {
+				do {
+					//Get data from netbuf
+					netbuf_data(inbuf, (void**)&buf, &buflen);
+
+					unsigned int pos = 0;
+					//segment may hold several pipelined requests
+					while((doexit == 0) && (pos < buflen)){
+						unsigned int used;
+
+						if(ctx->ws.route != NULL){
+							if(!wsReceive(&ctx->ws, (const u8_t*)&buf[pos], buflen - pos)){
+								doexit = 5;
+							}
+							pos = buflen;
+							continue;
+						}
+						if(ctx->body.route != NULL){
+							if(!bodyProcess(&ctx->w, conn, &ctx->parse, &ctx->body, &buf[pos], buflen - pos, &used)){
+								doexit = 100;
+							}
+							pos += used;
+							//Next request on persistent connection
+							if(ctx->body.route == NULL) edyht_parse_init(&ctx->parse);
+							continue;
+						}
+
+						//header deadline of further requests starts with their first byte
+						if((requests > 0) && edyht_parse_idle(&ctx->parse)) ctx->reqStart = sys_now();
+						int ret = edyht_parse(&ctx->parse, &buf[pos], buflen - pos, &used);
+						pos += used;
+
+						if(ret < 0) {
+							//Error!
+							webpageBadProcess(conn);
+							edyht_metrics_parse_error(ret);
+							doexit = 4;
+						}
+						else if(ret == CHARPROC_FINISHED){
+							//Process Webpage
+							requests++;
+							u8_t keepAlive = keepAliveCheck(&ctx->parse, requests, ctx->start);
+							if(!webpageProcess(&ctx->parse, &ctx->w, conn, keepAlive, &ctx->stream, &ctx->ws, &ctx->body)){
+								//Exit regularly
+								doexit = 100;
+							}
+							else if(ctx->stream.sse != NULL){
+								sseRun(&ctx->w, &ctx->stream);
+								doexit = 6;
+							}
+							//Next request on persistent connection, request of a pending body is kept
+							if(ctx->body.route == NULL) edyht_parse_init(&ctx->parse);
+						}
+					}
+				} while((doexit==0) && (netbuf_next(inbuf) >= 0));
+			} //if (netconn_err(conn) == ERR_OK)
+			else {
+				edyht_metrics_count(EDYHT_METRIC_ERROR);
+				doexit = 3;
+			}
+		} //if (recv_err == ERR_OK)
+		else if((recv_err == ERR_TIMEOUT) && (ctx->ws.route != NULL) && wsIdle(&ctx->ws)) {
+			//ping sent, wait for answer
+		}
+		else {
+			if(recv_err == ERR_TIMEOUT) edyht_metrics_count(reason);
+			else if(recv_err != ERR_CLSD) edyht_metrics_count(EDYHT_METRIC_ERROR);
+			doexit = 2;
+		}
+
+		// delete buffer)
+		netbuf_delete(inbuf);
+
+	} while(doexit == 0);
+
+
+	// close connection
+	bodyAbort(&ctx->body);
+	wsEnd(&ctx->ws);
+	netconn_close(conn);
+}
+
+
+static QueueHandle_t connQueue; //accepted connections waiting for a worker
+static httpCtx_t workerCtx[EDYHT_WORKERS];
+static unsigned int connActive; //accepted and not yet deleted, see EDYHT_MAX_CONNS
+
+//Admission control: count a new connection if below EDYHT_MAX_CONNS
+static int connAdmit(void){
+	int ok;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	ok = (connActive < EDYHT_MAX_CONNS);
+	if(ok) connActive++;
+	SYS_ARCH_UNPROTECT(lev);
+	return ok;
+}
+
+static void connRelease(void){
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	connActive--;
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+//Prebuilt 503 with Retry-After, written without waiting for send buffer space
+static void connReject(struct netconn *conn){
+	if(netconn_write(conn, assets[ASSET_err503_txt].data, assetSize(ASSET_err503_txt),
+			NETCONN_NOCOPY | NETCONN_DONTBLOCK) == ERR_OK){
+		rejectCount();
+	}
+	else{
+		edyht_metrics_count(EDYHT_METRIC_REJECTED);
+	}
+	netconn_close(conn);
+	netconn_delete(conn);
+}
+
+#define WS_SLOTS  EDYHT_WORKERS
+static inline edyht_ws_t* wsSlot(unsigned int i){
+	return &workerCtx[i].ws;
+}
+
+static void edyht_worker(void *arg)
+{
+	httpCtx_t *ctx = arg;
+	struct netconn *newconn;
+
+	while(1)
+	{
+		if(xQueueReceive(connQueue, &newconn, portMAX_DELAY) == pdTRUE)
+		{
+			//serve request
+			serve_get_request(ctx, newconn);
+			netconn_delete(newconn);
+			connRelease();
+		}
+	}
+}
+
+static void edyht_thread(void *arg)
+{ 
+	struct netconn *conn, *newconn;
+	err_t err, accept_err;
+
+	LWIP_UNUSED_ARG(arg);
+
+	conn = netconn_new(NETCONN_TCP);
+
+	if (conn!= NULL)
+	{
+		//bind (http port)
+		err = netconn_bind(conn, NULL, EDYHT_PORT);
+
+		if (err == ERR_OK)
+		{
+			netconn_listen(conn);
+			while(1)
+			{
+				//wait for incoming connection
+				accept_err = netconn_accept(conn, &newconn);
+				if(accept_err == ERR_OK)
+				{
+					//hand over to next free worker, never wait for one
+					if(!connAdmit()){
+						connReject(newconn);
+					}
+					else if(xQueueSend(connQueue, &newconn, 0) != pdTRUE){
+						connRelease();
+						connReject(newconn);
+					}
+					else{
+						edyht_metrics_count(EDYHT_METRIC_ACCEPTED);
+					}
+				}
+			}
+		}
+		else
+		{
+			//improvement: Notify error!
+			netconn_delete(conn);
+		}
+	}
+	else
+	{
+		//improvement: Notify error!
+	}
+	for(;;); //send thread to endless loop; should not happen!
+}
+
+static void serverStart(void)
+{
+	unsigned int i;
+
+	connQueue = xQueueCreate(EDYHT_ACCEPT_QUEUE_LEN, sizeof(struct netconn *));
+	if(connQueue == NULL) return; //improvement: Notify error!
+	if(sys_mutex_new(&cacheMutex) != ERR_OK) return;
+	for(i = 0; i < EDYHT_WORKERS; i++){
+		if(sys_mutex_new(&workerCtx[i].ws.lock) != ERR_OK) return;
+	}
+
+	for(i = 0; i < EDYHT_WORKERS; i++){
+		sys_thread_new("edyhtw", edyht_worker, &workerCtx[i], EDYHT_WORKER_STACK, EDYHT_WORKER_PRIO);
+	}
+	sys_thread_new("edyht", edyht_thread, NULL, EDYHT_ACCEPT_STACK, EDYHT_ACCEPT_PRIO);
+}
+
+#else //EDYHT_RAW_API
+
+/*
+ * Raw API backend: all callbacks and page handlers run in the tcpip thread.
+ * Responses are queued as pbufs (PBUF_ROM for const data, no copy) and
+ * handed to tcp_write as send buffer space becomes free.
+ */
+
+#define RAW_POLL_INTERVAL  2   //tcp_poll interval in units of 500 ms
+
+struct rawConn {
+	struct tcp_pcb *pcb;     //NULL: entry is free
+	edyht_req_t parse;
+	struct pbuf *rxq;        //received data not yet parsed
+	u16_t rxOffset;          //parsed bytes of first pbuf in rxq
+	struct pbuf *txq;        //response data not yet passed to tcp_write
+	u16_t txOffset;          //written bytes of first pbuf in txq
+	stream_t stream;         //streaming page, next part is produced when txq is empty
+	edyht_ws_t ws;           //after upgrade to WebSocket
+	body_t body;             //POST body being received
+	u8_t closing;            //close after txq is sent
+	int requests;
+	u32_t lastActive;        //sys_now() of last progress, for timeouts
+	u32_t start;             //sys_now() at accept, see EDYHT_CONN_BUDGET
+	u32_t reqStart;          //sys_now() at the first byte of the current request
+};
+
+static struct tcp_pcb *listenPcb;
+static struct rawConn rawConns[EDYHT_RAW_CONNS];
+static edyht_writer_t rawWriter; //handlers run to completion, one writer for all connections
+
+#define WS_SLOTS  EDYHT_RAW_CONNS
+static inline edyht_ws_t* wsSlot(unsigned int i){
+	return &rawConns[i].ws;
+}
+
+//Remove first pbuf from a queue built with pbuf_cat
+static inline void pbufDropFirst(struct pbuf **q){
+	struct pbuf *p = *q;
+	*q = p->next;
+	p->next = NULL;
+	p->tot_len = p->len;
+	pbuf_free(p);
+}
+
+static inline void pbufEnqueue(struct pbuf **q, struct pbuf *p){
+	if(*q == NULL) *q = p;
+	else pbuf_cat(*q, p);
+}
+
+static err_t connWrite(conn_t *rc, const void *data, unsigned int len, u8_t flags){
+	const u8_t *src = data;
+
+	while(len > 0){
+		u16_t n = (len > 0xffff) ? 0xffff : len;
+		struct pbuf *p;
+		if(flags & WRITE_COPY){
+			p = pbuf_alloc(PBUF_RAW, n, PBUF_RAM);
+			if(p == NULL) return ERR_MEM;
+			memcpy(p->payload, src, n);
+		}
+		else{
+			p = pbuf_alloc(PBUF_RAW, n, PBUF_ROM);
+			if(p == NULL) return ERR_MEM;
+			p->payload = (void*)src;
+		}
+		pbufEnqueue(&rc->txq, p);
+		src += n;
+		len -= n;
+	}
+	return ERR_OK;
+}
+
+static void rawFree(struct rawConn *rc){
+	while(rc->rxq != NULL) pbufDropFirst(&rc->rxq);
+	while(rc->txq != NULL) pbufDropFirst(&rc->txq);
+	streamAbort(&rc->stream);
+	bodyAbort(&rc->body);
+	rc->stream.sse = NULL;
+	rc->ws.route = NULL;
+	rc->pcb = NULL;
+}
+
+static err_t rawPoll(void *arg, struct tcp_pcb *pcb);
+static void rawSseTickStart(void);
+
+static void rawClose(struct rawConn *rc){
+	struct tcp_pcb *pcb = rc->pcb;
+
+	tcp_arg(pcb, NULL);
+	tcp_recv(pcb, NULL);
+	tcp_sent(pcb, NULL);
+	tcp_err(pcb, NULL);
+	tcp_poll(pcb, NULL, 0);
+	if(tcp_close(pcb) != ERR_OK){
+		//out of memory, try again from poll
+		tcp_arg(pcb, rc);
+		tcp_poll(pcb, rawPoll, RAW_POLL_INTERVAL);
+		return;
+	}
+	rawFree(rc);
+}
+
+//Hand queued response data to tcp_write as far as the send buffer allows
+static void rawSend(struct rawConn *rc){
+	struct tcp_pcb *pcb = rc->pcb;
+
+	while(rc->txq != NULL){
+		struct pbuf *p = rc->txq;
+		u16_t n = p->len - rc->txOffset;
+		u16_t space = tcp_sndbuf(pcb);
+		u8_t flags = (p->type == PBUF_ROM) ? WRITE_NOCOPY : WRITE_COPY;
+
+		if(space == 0) break;
+		if(n > space) n = space;
+		if((p->next != NULL) || (n < p->len - rc->txOffset)) flags |= WRITE_MORE;
+
+		if(tcp_write(pcb, (u8_t*)p->payload + rc->txOffset, n, flags) != ERR_OK) break; //retried from sent/poll
+		rc->txOffset += n;
+		if(rc->txOffset == p->len){
+			pbufDropFirst(&rc->txq);
+			rc->txOffset = 0;
+		}
+	}
+	tcp_output(pcb);
+}
+
+static void connPush(conn_t *rc){
+	rawSend(rc);
+}
+
+static void connNoDelay(conn_t *rc){
+	tcp_nagle_disable(rc->pcb);
+}
+
+//Produce parts of a pending streaming page as long as lwIP takes them
+static void rawStream(struct rawConn *rc){
+	if(rc->closing) rc->stream.sse = NULL; //event streams end with the connection
+
+	if(arrayAckPending(&rc->stream)){
+		if((rc->txq != NULL) || (tcp_sndqueuelen(rc->pcb) != 0)) return; //sent / retransmitted from the snapshot
+		arrayRelease(&rc->stream);
+		//Next request on persistent connection
+		edyht_parse_init(&rc->parse);
+	}
+
+	while(streamPending(&rc->stream) && (rc->txq == NULL)){
+		streamResume(&rawWriter, rc, &rc->parse, &rc->stream);
+		rawWriter.sent = 0;
+		if(rc->stream.sse != NULL){
+			if(!sseStep(&rawWriter, &rc->stream)) break; //nothing to send yet
+			writerSendBuf(&rawWriter, 0);
+			if(rawWriter.err != ERR_OK){
+				rc->stream.sse = NULL;
+				rc->closing = 1;
+			}
+		}
+		else if(!streamStep(&rawWriter, &rc->stream)){
+			if((rawWriter.err != ERR_OK) || !rc->stream.keepAlive) rc->closing = 1;
+			//Next request on persistent connection
+			edyht_parse_init(&rc->parse);
+		}
+		rawSend(rc);
+	}
+}
+
+//Parse received data and queue responses, stops while a response is pending
+static void rawService(struct rawConn *rc){
+	u32_t consumed = 0;
+
+	rawSend(rc);
+	rawStream(rc);
+
+	//WebSocket input and POST bodies are processed while data is still queued for sending
+	while((rc->rxq != NULL) && ((rc->txq == NULL) || (rc->ws.route != NULL) || (rc->body.route != NULL))
+			&& !streamPending(&rc->stream) && !rc->closing){
+		struct pbuf *p = rc->rxq;
+		const char *data = (const char*)p->payload + rc->rxOffset;
+		unsigned int used = p->len - rc->rxOffset;
+		int ret = CHARPROC_OK;
+
+		if(rc->ws.route != NULL){
+			if(!wsReceive(&rc->ws, (const u8_t*)data, used)) rc->closing = 1;
+		}
+		else if(rc->body.route != NULL){
+			if(!bodyProcess(&rawWriter, rc, &rc->parse, &rc->body, data, used, &used)) rc->closing = 1;
+			//Next request on persistent connection
+			if(rc->body.route == NULL) edyht_parse_init(&rc->parse);
+		}
+		else{
+			//header deadline of further requests starts with their first byte
+			if((rc->requests > 0) && edyht_parse_idle(&rc->parse)) rc->reqStart = sys_now();
+			ret = edyht_parse(&rc->parse, data, used, &used);
+		}
+
+		rc->rxOffset += used;
+		consumed += used;
+		if(rc->rxOffset == p->len){
+			pbufDropFirst(&rc->rxq);
+			rc->rxOffset = 0;
+		}
+
+		if(ret < 0){
+			//Error!
+			webpageBadProcess(rc);
+			edyht_metrics_parse_error(ret);
+			rc->closing = 1;
+		}
+		else if(ret == CHARPROC_FINISHED){
+			//Process Webpage
+			rc->requests++;
+			u8_t keepAlive = keepAliveCheck(&rc->parse, rc->requests, rc->start);
+			if(!webpageProcess(&rc->parse, &rawWriter, rc, keepAlive, &rc->stream, &rc->ws, &rc->body)){
+				rc->closing = 1;
+			}
+			//Next request on persistent connection, request of a pending stream or body is kept
+			if(!streamPending(&rc->stream) && (rc->body.route == NULL)) edyht_parse_init(&rc->parse);
+			if(rc->stream.sse != NULL) rawSseTickStart();
+		}
+		rawSend(rc);
+		rawStream(rc);
+	}
+
+	while(consumed > 0){
+		u16_t n = (consumed > 0xffff) ? 0xffff : consumed;
+		tcp_recved(rc->pcb, n);
+		consumed -= n;
+	}
+
+	if(rc->closing) rc->ws.route = NULL; //no frames after close
+	if(rc->closing && (rc->txq == NULL) && !arrayAckPending(&rc->stream)) rawClose(rc);
+}
+
+static err_t rawRecv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err){
+	struct rawConn *rc = arg;
+
+	if(p == NULL){
+		//closed by client, finish pending response
+		rc->closing = 1;
+		rawService(rc);
+		return ERR_OK;
+	}
+	if(err != ERR_OK){
+		pbuf_free(p);
+		return err;
+	}
+	if(rc->closing){
+		tcp_recved(pcb, p->tot_len);
+		pbuf_free(p);
+		return ERR_OK;
+	}
+
+	rc->lastActive = sys_now();
+	pbufEnqueue(&rc->rxq, p);
+	rawService(rc);
+	return ERR_OK;
+}
+
+static err_t rawSent(void *arg, struct tcp_pcb *pcb, u16_t len){
+	struct rawConn *rc = arg;
+
+	LWIP_UNUSED_ARG(pcb);
+	LWIP_UNUSED_ARG(len);
+
+	rc->lastActive = sys_now();
+	rawService(rc);
+	return ERR_OK;
+}
+
+static err_t rawPoll(void *arg, struct tcp_pcb *pcb){
+	struct rawConn *rc = arg;
+	u32_t timeout = EDYHT_RECV_TIMEOUT;
+
+	if(rc == NULL){
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	if((rc->txq == NULL) && (rc->requests > 0) && edyht_parse_idle(&rc->parse)){
+		timeout = EDYHT_KEEPALIVE_TIMEOUT; //idle between requests
+	}
+	if(rc->ws.route != NULL){
+		if((u32_t)(sys_now() - rc->ws.lastRx) > EDYHT_WS_PING){
+			if(!wsIdle(&rc->ws)) rc->closing = 1; //no answer to the previous ping
+			rc->ws.lastRx = sys_now();
+		}
+		if(rc->txq == NULL) rc->lastActive = sys_now();
+	}
+	if((rc->txq == NULL) && (rc->stream.sse != NULL)){
+		rc->lastActive = sys_now(); //waiting for events, heartbeats detect closed connections
+	}
+	if(!rc->closing && (rc->txq == NULL) && !streamPending(&rc->stream) && (rc->body.route == NULL)
+			&& (rc->ws.route == NULL) && ((rc->requests == 0) || !edyht_parse_idle(&rc->parse))){
+		//request line and headers
+		if((u32_t)(sys_now() - rc->reqStart) >= EDYHT_HEADER_TIMEOUT){
+			edyht_metrics_count(EDYHT_METRIC_HEADER_TIMEOUT);
+			rc->closing = 1;
+		}
+	}
+#if EDYHT_CONN_BUDGET > 0
+	if(!rc->closing && (rc->txq == NULL) && !streamPending(&rc->stream) && (rc->ws.route == NULL)
+			&& ((u32_t)(sys_now() - rc->start) >= EDYHT_CONN_BUDGET)){
+		edyht_metrics_count(EDYHT_METRIC_BUDGET);
+		rc->closing = 1;
+	}
+#endif
+	if((u32_t)(sys_now() - rc->lastActive) > timeout){
+		if((rc->txq != NULL) || arrayAckPending(&rc->stream)){
+			//client does not take the response
+			edyht_metrics_count(EDYHT_METRIC_ABORTED);
+			rawFree(rc);
+			tcp_arg(pcb, NULL);
+			tcp_abort(pcb);
+			return ERR_ABRT;
+		}
+		if(!rc->closing) edyht_metrics_count(EDYHT_METRIC_TIMEOUT);
+		rc->closing = 1;
+	}
+
+	rawService(rc);
+	return ERR_OK;
+}
+
+static u8_t sseTickArmed;
+
+//Event streams check for published data every EDYHT_SSE_TICK ms
+static void rawSseTick(void *arg){
+	u8_t active = 0;
+	int i;
+
+	LWIP_UNUSED_ARG(arg);
+
+	sseTickArmed = 0;
+	for(i = 0; i < EDYHT_RAW_CONNS; i++){
+		struct rawConn *rc = &rawConns[i];
+		if((rc->pcb == NULL) || (rc->stream.sse == NULL)) continue;
+		rawService(rc);
+		if((rc->pcb != NULL) && (rc->stream.sse != NULL)) active = 1;
+	}
+	if(active) rawSseTickStart();
+}
+
+static void rawSseTickStart(void){
+	if(sseTickArmed) return;
+	sseTickArmed = 1;
+	sys_timeout(EDYHT_SSE_TICK, rawSseTick, NULL);
+}
+
+static void rawErr(void *arg, err_t err){
+	struct rawConn *rc = arg;
+
+	LWIP_UNUSED_ARG(err);
+
+	//pcb is already freed by lwIP
+	if(rc != NULL){
+		edyht_metrics_count(EDYHT_METRIC_ERROR);
+		rawFree(rc);
+	}
+}
+
+static err_t rawAccept(void *arg, struct tcp_pcb *newpcb, err_t err){
+	struct rawConn *rc = NULL;
+	int i;
+
+	LWIP_UNUSED_ARG(arg);
+
+	if((err != ERR_OK) || (newpcb == NULL)) return ERR_VAL;
+	tcp_accepted(listenPcb);
+
+	for(i = 0; i < EDYHT_RAW_CONNS; i++){
+		if(rawConns[i].pcb == NULL){
+			rc = &rawConns[i];
+			break;
+		}
+	}
+	if(rc == NULL){
+		//no free connection: prebuilt 503 (const, no copy) and close, reset if that fails
+		if((tcp_write(newpcb, assets[ASSET_err503_txt].data, assetSize(ASSET_err503_txt), WRITE_NOCOPY) != ERR_OK)
+				|| (tcp_close(newpcb) != ERR_OK)){
+			edyht_metrics_count(EDYHT_METRIC_REJECTED);
+			tcp_abort(newpcb);
+			return ERR_ABRT;
+		}
+		rejectCount();
+		return ERR_OK;
+	}
+
+	edyht_metrics_count(EDYHT_METRIC_ACCEPTED);
+	rc->pcb = newpcb;
+	rc->rxq = NULL;
+	rc->rxOffset = 0;
+	rc->txq = NULL;
+	rc->txOffset = 0;
+	rc->stream.provider = NULL;
+	rc->stream.array = NULL;
+	rc->stream.sse = NULL;
+	rc->ws.route = NULL;
+	rc->body.route = NULL;
+	rc->closing = 0;
+	rc->requests = 0;
+	rc->lastActive = sys_now();
+	rc->start = rc->lastActive;
+	rc->reqStart = rc->lastActive;
+	edyht_parse_init(&rc->parse);
+
+	tcp_setprio(newpcb, TCP_PRIO_MIN);
+	tcp_arg(newpcb, rc);
+	tcp_recv(newpcb, rawRecv);
+	tcp_sent(newpcb, rawSent);
+	tcp_err(newpcb, rawErr);
+	tcp_poll(newpcb, rawPoll, RAW_POLL_INTERVAL);
+	return ERR_OK;
+}
+
+//Runs in the tcpip thread
+static void rawInit(void *arg){
+	struct tcp_pcb *pcb;
+
+	LWIP_UNUSED_ARG(arg);
+
+	pcb = tcp_new();
+	if(pcb == NULL) return; //improvement: Notify error!
+
+	//bind (http port)
+	if(tcp_bind(pcb, IP_ADDR_ANY, EDYHT_PORT) != ERR_OK){
+		tcp_close(pcb);
+		return; //improvement: Notify error!
+	}
+	listenPcb = tcp_listen(pcb);
+	if(listenPcb == NULL){
+		tcp_close(pcb);
+		return; //improvement: Notify error!
+	}
+	tcp_accept(listenPcb, rawAccept);
+}
+
+static void serverStart(void)
+{
+	tcpip_callback(rawInit, NULL);
+}
+
+#endif //EDYHT_RAW_API
+
+int edyht_ws_broadcast(const char *name, int binary, const void *data, unsigned int len){
+	unsigned int i;
+	int n = 0;
+
+	for(i = 0; i < WS_SLOTS; i++){
+		edyht_ws_t *ws = wsSlot(i);
+		const route_t *route = ws->route;
+		if((route == NULL) || ((name != NULL) && (strcmp(route->name, name) != 0))) continue;
+		if(edyht_ws_send(ws, binary, data, len) == EDYHT_OK) n++;
+	}
+	return n;
+}
+
+void edyht_invalidate(const char *name){
+#if EDYHT_CACHE_ENTRIES > 0
+	unsigned int i;
+
+	CACHE_LOCK();
+	cacheGen++;
+	for(i = 0; i < EDYHT_CACHE_ENTRIES; i++){
+		cacheEntry_t *e = &cache[i];
+		if((e->route != NULL) && ((name == NULL) || (strcmp(e->route->name, name) == 0))){
+			e->expires = sys_now(); //expired, reused when no longer sent
+		}
+	}
+	CACHE_UNLOCK();
+#else
+	LWIP_UNUSED_ARG(name);
+#endif
+}
+
+void edyht_init()
+{
+	unsigned int i;
+	etagSalt = EDYHT_ETAG_SALT() ^ routeHash(__DATE__ " " __TIME__);
+	arrayFill();
+
+	for(i = 0; i < sizeof(builtinRoutes)/sizeof(builtinRoutes[0]); i++){
+		if(builtinRoutes[i].provider != NULL){
+			edyht_register_stream(builtinRoutes[i].name, builtinRoutes[i].type, builtinRoutes[i].provider, builtinRoutes[i].version);
+		}
+		else if(builtinRoutes[i].ttl > 0){
+			edyht_register_handler_cached(builtinRoutes[i].name, builtinRoutes[i].type, builtinRoutes[i].handler, builtinRoutes[i].ttl);
+		}
+		else if(builtinRoutes[i].version != NULL){
+			edyht_register_handler_versioned(builtinRoutes[i].name, builtinRoutes[i].type, builtinRoutes[i].handler, builtinRoutes[i].version);
+		}
+		else{
+			edyht_register_handler(builtinRoutes[i].name, builtinRoutes[i].type, builtinRoutes[i].handler);
+		}
+	}
+
+	//Templates from htdocs/tpl/, demo slots unless the application registered its own
+	for(i = 0; i < TPL_COUNT; i++){
+		tplRegister(&templates[i]);
+	}
+	for(i = 0; i < sizeof(builtinSlots)/sizeof(builtinSlots[0]); i++){
+		int slot = slotFind(builtinSlots[i].name);
+		if((slot >= 0) && (slotRenderers[slot] == NULL)) slotRenderers[slot] = builtinSlots[i].render;
+	}
+
+	edyht_register_ws("testform.ws", ws_testform);
+	edyht_register_form("testform.post", EDYHT_CONTENT_PLAIN, form_testform, page_testpost);
+	edyht_register_upload("test.upload", EDYHT_CONTENT_PLAIN, sink_testupload, page_testupload);
+	edyht_register_array("test.dat", &arrayEndpoint);
+
+	//Files from htdocs/, index.htm is also the default page
+	for(i = 0; i < ASSET_COUNT; i++){
+		const asset_t *a = &assets[i];
+		if(a->name == NULL) continue;
+		assetRegister(a->name, a);
+		if(strcmp(a->name, "index.htm") == 0) assetRegister("", a);
+	}
+
+	serverStart();
+}
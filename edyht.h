@@ -1,6 +1,373 @@
-#ifndef __EDYHT_H__
-#define __EDYHT_H__
-
-void edyht_init(void);
-
-#endif // __EDYHT_H__
+#ifndef __EDYHT_H__
+#define __EDYHT_H__
+
+struct netconn;
+
+/* Size of the route hash table, must be a power of 2 and should be about
+ * twice the number of registered routes */
+#ifndef EDYHT_ROUTES_SIZE
+#define EDYHT_ROUTES_SIZE 128
+#endif
+
+/* TCP port of the server */
+#ifndef EDYHT_PORT
+#define EDYHT_PORT 80
+#endif
+
+/* Backend: 0 = netconn API with worker tasks, 1 = lwIP raw API callbacks.
+ * With the raw API all page handlers run in the tcpip thread and must not
+ * block; no edyht tasks are created. */
+#ifndef EDYHT_RAW_API
+#define EDYHT_RAW_API 0
+#endif
+
+/* Max. number of concurrent connections with EDYHT_RAW_API */
+#ifndef EDYHT_RAW_CONNS
+#define EDYHT_RAW_CONNS 4
+#endif
+
+/* Number of worker tasks serving connections in parallel */
+#ifndef EDYHT_WORKERS
+#define EDYHT_WORKERS 2
+#endif
+
+/* Stack size (words) and priority of the worker tasks */
+#ifndef EDYHT_WORKER_STACK
+#define EDYHT_WORKER_STACK 2500
+#endif
+#ifndef EDYHT_WORKER_PRIO
+#define EDYHT_WORKER_PRIO (tskIDLE_PRIORITY + 3)
+#endif
+
+/* Stack size (words) and priority of the task accepting connections */
+#ifndef EDYHT_ACCEPT_STACK
+#define EDYHT_ACCEPT_STACK 512
+#endif
+#ifndef EDYHT_ACCEPT_PRIO
+#define EDYHT_ACCEPT_PRIO (tskIDLE_PRIORITY + 3)
+#endif
+
+/* Accepted connections waiting for a free worker */
+#ifndef EDYHT_ACCEPT_QUEUE_LEN
+#define EDYHT_ACCEPT_QUEUE_LEN 4
+#endif
+
+/* Max. number of connections being served or waiting for a worker. Further
+ * clients get the prebuilt "503 Service Unavailable" (htdocs/err503.txt,
+ * Retry-After see mkhtdocs.sh) and are closed right away, so the accept
+ * task never blocks. With EDYHT_RAW_API the limit is EDYHT_RAW_CONNS. */
+#ifndef EDYHT_MAX_CONNS
+#define EDYHT_MAX_CONNS (EDYHT_WORKERS + EDYHT_ACCEPT_QUEUE_LEN)
+#endif
+
+/* Deadline (ms) for request line and headers, counted from the start of
+ * serving (raw API: accept) resp. from the first byte of further requests
+ * on a persistent connection */
+#ifndef EDYHT_HEADER_TIMEOUT
+#define EDYHT_HEADER_TIMEOUT 1000
+#endif
+
+/* Receive timeout (ms) while a request body is being received */
+#ifndef EDYHT_RECV_TIMEOUT
+#define EDYHT_RECV_TIMEOUT 2000
+#endif
+
+/* Total time (ms) a connection may take, incl. uploads; 0 = no limit. A
+ * persistent connection is closed after the response that exceeds it.
+ * Event streams and WebSockets are not limited. */
+#ifndef EDYHT_CONN_BUDGET
+#define EDYHT_CONN_BUDGET 30000
+#endif
+
+/* Idle timeout (ms) of persistent connections between requests. Note that
+ * an idle connection keeps its worker busy, see EDYHT_WORKERS. */
+#ifndef EDYHT_KEEPALIVE_TIMEOUT
+#define EDYHT_KEEPALIVE_TIMEOUT 3000
+#endif
+
+/* Max. number of requests served on one persistent connection */
+#ifndef EDYHT_KEEPALIVE_MAX
+#define EDYHT_KEEPALIVE_MAX 100
+#endif
+
+/* Size of the response buffer of dynamic pages, default one TCP segment */
+#ifndef EDYHT_WRITER_LEN
+#define EDYHT_WRITER_LEN TCP_MSS
+#endif
+
+/* Request buffer of each connection. The request line and the headers
+ * evaluated by the server must fit (400 otherwise), other header lines are
+ * not stored. */
+#ifndef EDYHT_REQ_LEN
+#define EDYHT_REQ_LEN 512
+#endif
+
+/* Interval (ms) in which event streams check for published data */
+#ifndef EDYHT_SSE_TICK
+#define EDYHT_SSE_TICK 50
+#endif
+
+/* An event stream without events sends a comment after this time (ms), so
+ * that closed connections are detected */
+#ifndef EDYHT_SSE_HEARTBEAT
+#define EDYHT_SSE_HEARTBEAT 15000
+#endif
+
+/* Max. size of a received WebSocket message, one buffer per connection */
+#ifndef EDYHT_WS_MSG_LEN
+#define EDYHT_WS_MSG_LEN 128
+#endif
+
+/* A WebSocket client is pinged after this time (ms) without data and
+ * disconnected if it does not answer within the same time */
+#ifndef EDYHT_WS_PING
+#define EDYHT_WS_PING 10000
+#endif
+
+/* Netconn backend with LWIP_SO_SNDTIMEO: a WebSocket client that does not
+ * take a frame within this time (ms) is disconnected */
+#ifndef EDYHT_WS_SEND_TIMEOUT
+#define EDYHT_WS_SEND_TIMEOUT 500
+#endif
+
+/* Max. size of one decoded field (name and value) of a POST form body,
+ * one buffer per connection. Longer fields fail the request. */
+#ifndef EDYHT_FORM_FIELD_LEN
+#define EDYHT_FORM_FIELD_LEN 128
+#endif
+
+/* Request metrics served at /metrics (Prometheus) and /metrics.json */
+#ifndef EDYHT_METRICS
+#define EDYHT_METRICS 1
+#endif
+
+/* Routes with own counters, further routes share the "_other" counters */
+#ifndef EDYHT_METRICS_ROUTES
+#define EDYHT_METRICS_ROUTES 24
+#endif
+
+/* Latency histogram: bucket b counts requests shorter than
+ * 2^(b + EDYHT_METRICS_BUCKET_SHIFT) clock ticks, the last one all others */
+#ifndef EDYHT_METRICS_BUCKETS
+#define EDYHT_METRICS_BUCKETS 16
+#endif
+#ifndef EDYHT_METRICS_BUCKET_SHIFT
+#define EDYHT_METRICS_BUCKET_SHIFT 0
+#endif
+
+/* EDYHT_METRICS_CLOCK(): free running 32 bit counter for request durations,
+ * EDYHT_METRICS_CLOCK_HZ its frequency. Default sys_now() (1000 Hz). For
+ * sub-millisecond resolution use the DWT cycle counter of Cortex-M3/M4/M7:
+ * EDYHT_METRICS_CLOCK() = DWT->CYCCNT, EDYHT_METRICS_CLOCK_HZ =
+ * SystemCoreClock, EDYHT_METRICS_BUCKET_SHIFT = 10 (after setting TRCENA in
+ * CoreDebug->DEMCR and CYCCNTENA in DWT->CTRL). */
+
+/* Response cache of edyht_register_handler_cached: number of entries and
+ * bytes per entry (normalized query, header and body). Larger responses
+ * are not cached, they are sent while rendered without Content-Length and
+ * the connection is closed. 0 entries: no cache. The default slot holds
+ * tasks.htm / tasks.json with EDYHT_TASKS_MAX tasks (up to 136 bytes each). */
+#ifndef EDYHT_CACHE_ENTRIES
+#define EDYHT_CACHE_ENTRIES 4
+#endif
+#ifndef EDYHT_CACHE_SLOT_LEN
+#define EDYHT_CACHE_SLOT_LEN (384 + 136 * EDYHT_TASKS_MAX)
+#endif
+
+/* tasks.htm / tasks.json: max. number of tasks in the snapshot and its
+ * lifetime (ms). Requests within the lifetime share one snapshot, so
+ * refreshing the page does not stop the scheduler more often. */
+#ifndef EDYHT_TASKS_MAX
+#define EDYHT_TASKS_MAX 16
+#endif
+#ifndef EDYHT_TASKS_TTL
+#define EDYHT_TASKS_TTL 1000
+#endif
+
+/* EDYHT_ETAG_SALT(): value mixed into the ETags of versioned dynamic pages,
+ * must differ between boots so that version counters starting again at 0
+ * do not match copies cached before a reset. Default LWIP_RAND() if the
+ * port defines it, else sys_now() at startup. */
+
+#define EDYHT_OK             0
+#define EDYHT_ERR_ARG       -1
+#define EDYHT_ERR_FULL      -2
+#define EDYHT_ERR_EXISTS    -3
+#define EDYHT_ERR_CONN      -4
+
+typedef enum {
+	EDYHT_CONTENT_NONE,   //data / handler provides complete response incl. header, handler closes connection
+	EDYHT_CONTENT_HTML,
+	EDYHT_CONTENT_CSV,
+	EDYHT_CONTENT_PNG,
+	EDYHT_CONTENT_JSON,
+	EDYHT_CONTENT_JS,
+	EDYHT_CONTENT_PLAIN,
+	EDYHT_CONTENT_CBOR,
+	EDYHT_CONTENT_BINARY, //application/octet-stream
+} edyht_content_t;
+
+/* Value type of array endpoints, 32 bit each */
+typedef enum {
+	EDYHT_ELEM_INT32,
+	EDYHT_ELEM_UINT32,
+	EDYHT_ELEM_FLOAT32,
+} edyht_elem_t;
+
+typedef struct edyht_writer edyht_writer_t;
+typedef struct edyht_sse edyht_sse_t;
+typedef struct edyht_ws edyht_ws_t;
+typedef struct edyht_snap edyht_snap_t;
+
+/* Array endpoint: n values of type in each buffer of snap (edyht_snap.h).
+ * frac is used by the text formats: decimals of floats, fixed point digits
+ * of EDYHT_ELEM_INT32 (0: integer). */
+typedef struct {
+	edyht_snap_t *snap;
+	unsigned int n;
+	edyht_elem_t type;
+	unsigned int frac;
+} edyht_array_t;
+
+typedef void (*edyht_handler_t)(edyht_writer_t *w);
+
+/* Message of a WebSocket client, text messages are "0" terminated */
+typedef void (*edyht_ws_handler_t)(edyht_ws_t *ws, int binary, const void *data, unsigned int len);
+
+/* Field of a POST form body, see edyht_register_form. Return 0 to fail
+ * the request. Called with name == NULL if the body ends incomplete or
+ * the request failed. */
+typedef int (*edyht_form_field_t)(const char *name, const char *value);
+
+/* Piece of a POST body starting at byte offset, see edyht_register_upload.
+ * Return 0 to fail the request. Called with data == NULL if the body ends
+ * incomplete or was failed. */
+typedef int (*edyht_body_sink_t)(unsigned int offset, const void *data, unsigned int len);
+
+/* Pull-style provider of a streaming page, see edyht_register_stream.
+ * Appends the next part of the body and returns 1 while more follows, 0
+ * after the last part. *cursor is 0 on the first call of a request and is
+ * kept between calls. If the connection fails after a call returned 1, the
+ * provider is called once more with w == NULL to release what it holds. */
+typedef int (*edyht_provider_t)(edyht_writer_t *w, unsigned int *cursor);
+
+/* Starts the server. Routes registered before edyht_init take precedence
+ * over the built-in pages of the same name. */
+void edyht_init(void);
+
+/* Register a static asset, name is the filename without leading "/".
+ * With EDYHT_CONTENT_NONE data must be a complete response incl.
+ * Content-Length as generated by tools/mkassets, otherwise the server sends the
+ * header incl. Content-Length.
+ * name and data must stay valid (e.g. const in flash).
+ * Registration is not thread safe, register routes during startup. */
+int edyht_register_static(const char *name, edyht_content_t type, const void *data, unsigned int len);
+
+/* Register a dynamic page. The server sends "200 OK" and the content type
+ * header before calling the handler and uses chunked encoding on persistent
+ * connections. With EDYHT_CONTENT_NONE the handler sends the complete
+ * response and the connection is closed afterwards. */
+int edyht_register_handler(const char *name, edyht_content_t type, edyht_handler_t handler);
+
+/* Dynamic page with validator: version points to a counter the application
+ * increments after each change of the data shown by the handler. The server
+ * sends it as ETag and answers a matching If-None-Match with "304 Not
+ * Modified" without calling the handler. type must not be
+ * EDYHT_CONTENT_NONE. Files from htdocs/ get their ETag at build time. */
+int edyht_register_handler_versioned(const char *name, edyht_content_t type, edyht_handler_t handler,
+		const volatile unsigned int *version);
+
+/* Dynamic page with response cache: the complete response is kept for ttl
+ * ms and sent to further requests of the same route and query (in any
+ * order) without calling the handler. type must not be
+ * EDYHT_CONTENT_NONE. See EDYHT_CACHE_ENTRIES. */
+int edyht_register_handler_cached(const char *name, edyht_content_t type, edyht_handler_t handler,
+		unsigned int ttl);
+
+/* Renderer of the placeholder {{name}} in the templates of htdocs/tpl/
+ * (see tools/mkassets.c). A template is served like a dynamic page: its
+ * static text is sent from flash as is and render is called for each
+ * placeholder of that name, in the order they appear. Placeholders without
+ * renderer stay empty. Returns EDYHT_ERR_ARG if no template uses name. */
+int edyht_register_slot(const char *name, edyht_handler_t render);
+
+/* Drop cached responses of route name (NULL: all) after the data shown by
+ * its handler changed. With EDYHT_RAW_API call from the tcpip thread only. */
+void edyht_invalidate(const char *name);
+
+/* Streaming page: the provider is called repeatedly, the output of each call
+ * is sent as one chunk (chunked encoding on persistent connections). A call
+ * should not write more than edyht_write_space() bytes. With EDYHT_RAW_API
+ * the next call only happens after lwIP took the previous chunk, so RAM use
+ * is bounded by one chunk per connection and the tcpip thread is not
+ * blocked by large responses. version is optional (NULL), see
+ * edyht_register_handler_versioned. */
+int edyht_register_stream(const char *name, edyht_content_t type, edyht_provider_t provider,
+		const volatile unsigned int *version);
+
+/* Array endpoint: the latest published buffer of array->snap is sent in
+ * the format chosen by the query "fmt=json|csv|cbor|raw" or else by the
+ * Accept header (application/json, application/cbor,
+ * application/octet-stream, text/csv), default JSON. cbor is a typed array
+ * (RFC 8746), raw an 8 byte header followed by the values, both little
+ * endian and sent zero-copy from the snapshot with EDYHT_RAW_API. The
+ * snapshot seq is sent as ETag. array must stay valid. */
+int edyht_register_array(const char *name, const edyht_array_t *array);
+
+/* Server-Sent Events (text/event-stream): the connection stays open and
+ * gets an event whenever the application publishes changes of topic, see
+ * edyht_sse.h. The first event holds all values. With the netconn backend
+ * every subscriber occupies a worker task, see EDYHT_WORKERS. */
+int edyht_register_sse(const char *name, edyht_sse_t *topic);
+
+/* WebSocket endpoint (RFC 6455): after the upgrade handshake complete
+ * text and binary messages of up to EDYHT_WS_MSG_LEN bytes are passed to
+ * handler, ping and close are answered by the server. With the netconn
+ * backend every client occupies a worker task, see EDYHT_WORKERS. */
+int edyht_register_ws(const char *name, edyht_ws_handler_t handler);
+
+/* POST endpoints. The body (Content-Length required, no chunked request
+ * bodies) is passed on as it is received, never buffered as a whole: a
+ * form (application/x-www-form-urlencoded) field by field with name and
+ * value decoded and "0" terminated, an upload as it arrives in segments.
+ * "Expect: 100-continue" is answered. After the complete body the handler
+ * writes the response as for edyht_register_handler, query strings are
+ * available there. A failed callback, malformed body or GET request gets
+ * "400 Bad Request" and the connection is closed. Callbacks of different
+ * connections may run at the same time with the netconn backend. type must
+ * not be EDYHT_CONTENT_NONE. */
+int edyht_register_form(const char *name, edyht_content_t type, edyht_form_field_t field, edyht_handler_t handler);
+int edyht_register_upload(const char *name, edyht_content_t type, edyht_body_sink_t sink, edyht_handler_t handler);
+
+/* Send a message to one client, e.g. the answer from a handler, or to all
+ * clients of route name (NULL: all WebSocket clients). With EDYHT_RAW_API
+ * call these from the tcpip thread only (handlers, tcpip_callback). With
+ * the netconn backend they may be called from any task and wait until lwIP
+ * took the data, at most EDYHT_WS_SEND_TIMEOUT per client if LWIP_SO_SNDTIMEO
+ * is enabled. broadcast returns the number of clients reached. */
+int edyht_ws_send(edyht_ws_t *ws, int binary, const void *data, unsigned int len);
+int edyht_ws_broadcast(const char *name, int binary, const void *data, unsigned int len);
+
+/* Response output of handlers. Data is collected in a buffer of
+ * EDYHT_WRITER_LEN bytes and only handed to lwIP when the buffer is full
+ * or the handler returns. */
+void edyht_write(edyht_writer_t *w, const void *data, unsigned int len);
+void edyht_write_const(edyht_writer_t *w, const void *data, unsigned int len); //data must stay valid (flash), large blocks are sent zero-copy
+void edyht_printf(edyht_writer_t *w, const char *fmt, ...); //output is truncated to EDYHT_WRITER_LEN-1 chars
+void edyht_flush(edyht_writer_t *w);
+unsigned int edyht_write_space(edyht_writer_t *w); //bytes left in the current buffer / chunk
+
+/* Direct access to the output buffer for serializers: reserve returns room
+ * for at least len (<= EDYHT_WRITER_LEN) bytes, commit appends the bytes
+ * actually written. */
+char* edyht_write_reserve(edyht_writer_t *w, unsigned int len);
+void edyht_write_commit(edyht_writer_t *w, unsigned int len);
+
+/* Query of the request being served, w is the writer passed to the handler.
+ * The strings stay valid until the handler returns. */
+int edyht_query_count(edyht_writer_t *w);
+const char* edyht_query_name(edyht_writer_t *w, int idx);
+const char* edyht_query_value(edyht_writer_t *w, int idx);
+const char* edyht_query_get(edyht_writer_t *w, const char *name);
+
+#endif // __EDYHT_H__
@@ -0,0 +1,306 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht_fmt.c
+ * @brief edyht - number serializers for data endpoints
+ * @copyright BSD 2-Clause License
+ *
+ * Allocation-free integer, fixed-point and float to ASCII conversion using
+ * a digit-pair lookup table, helpers streaming arrays of samples as JSON or
+ * CSV directly into the response buffer and the headers of the binary
+ * array formats.
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "edyht_fmt.h"
+
+static const char digitPairs[201] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+static const unsigned int pow10Tab[10] = {
+		1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+//Write exactly "digits" digits of val (leading zeros) ending at end
+static inline void fmtDigits(char *end, unsigned int val, unsigned int digits){
+	while(digits >= 2){
+		unsigned int idx = (val % 100) * 2;
+		val /= 100;
+		end -= 2;
+		end[0] = digitPairs[idx];
+		end[1] = digitPairs[idx + 1];
+		digits -= 2;
+	}
+	if(digits){
+		*--end = '0' + (val % 10);
+	}
+}
+
+static inline unsigned int numDigits(unsigned int val){
+	unsigned int n = 1;
+	while((n < 10) && (val >= pow10Tab[n])) n++;
+	return n;
+}
+
+int edyht_fmt_uint(char *buf, unsigned int val){
+	unsigned int n = numDigits(val);
+	fmtDigits(&buf[n], val, n);
+	return n;
+}
+
+int edyht_fmt_int(char *buf, int val){
+	if(val < 0){
+		buf[0] = '-';
+		return 1 + edyht_fmt_uint(&buf[1], 0u - (unsigned int)val);
+	}
+	return edyht_fmt_uint(buf, val);
+}
+
+static int fmtUint64(char *buf, unsigned long long val){
+	int len;
+	if(val <= 0xffffffffu) return edyht_fmt_uint(buf, (unsigned int)val);
+	len = fmtUint64(buf, val / 1000000000u);
+	fmtDigits(&buf[len + 9], (unsigned int)(val % 1000000000u), 9);
+	return len + 9;
+}
+
+int edyht_fmt_fix(char *buf, int val, unsigned int frac){
+	unsigned int mag;
+	int len = 0;
+
+	if(frac > 9) frac = 9;
+	if(val < 0){
+		buf[len++] = '-';
+		mag = 0u - (unsigned int)val;
+	}
+	else{
+		mag = val;
+	}
+	len += edyht_fmt_uint(&buf[len], mag / pow10Tab[frac]);
+	if(frac){
+		buf[len++] = '.';
+		fmtDigits(&buf[len + frac], mag % pow10Tab[frac], frac);
+		len += frac;
+	}
+	return len;
+}
+
+int edyht_fmt_float(char *buf, float val, unsigned int decimals){
+	unsigned long long ip;
+	unsigned int fp;
+	float mag;
+	int len = 0;
+
+	if(decimals > 9) decimals = 9;
+	if(!isfinite(val)) return 0;
+
+	mag = fabsf(val);
+	if(!(mag < 1.8e19f)) return 0; //does not fit 64 bit
+
+	//integer and fractional part separately, mag - ip is exact in float
+	ip = (unsigned long long)mag;
+	fp = (unsigned int)((mag - (float)ip) * (float)pow10Tab[decimals] + 0.5f);
+	if(fp >= pow10Tab[decimals]){
+		fp -= pow10Tab[decimals];
+		ip++;
+	}
+
+	if((val < 0) && ((ip != 0) || (fp != 0))) buf[len++] = '-';
+	len += fmtUint64(&buf[len], ip);
+	if(decimals){
+		buf[len++] = '.';
+		fmtDigits(&buf[len + decimals], fp, decimals);
+		len += decimals;
+	}
+	return len;
+}
+
+//Tags of little endian typed arrays (RFC 8746), index is edyht_elem_t
+static const unsigned char cborArrayTags[] = {
+		[EDYHT_ELEM_INT32]   = 78,
+		[EDYHT_ELEM_UINT32]  = 70,
+		[EDYHT_ELEM_FLOAT32] = 85,
+};
+
+static inline void fmtLe16(unsigned char *buf, unsigned int val){
+	buf[0] = val;
+	buf[1] = val >> 8;
+}
+
+int edyht_fmt_array_header(unsigned char *buf, edyht_fmt_t fmt, edyht_elem_t type, unsigned int n){
+	unsigned int bytes = n * 4;
+
+	if(fmt == EDYHT_FMT_RAW){
+		buf[0] = type;
+		buf[1] = 4;
+		fmtLe16(&buf[2], EDYHT_FMT_BIN_HDR);
+		fmtLe16(&buf[4], n);
+		fmtLe16(&buf[6], n >> 16); //32 bit
+		return EDYHT_FMT_BIN_HDR;
+	}
+	//tag, then byte string (major type 2) with big endian length
+	buf[0] = 0xd8;
+	buf[1] = cborArrayTags[type];
+	if(bytes < 24){
+		buf[2] = 0x40 | bytes;
+		return 3;
+	}
+	if(bytes <= 0xff){
+		buf[2] = 0x58;
+		buf[3] = bytes;
+		return 4;
+	}
+	if(bytes <= 0xffff){
+		buf[2] = 0x59;
+		buf[3] = bytes >> 8;
+		buf[4] = bytes;
+		return 5;
+	}
+	buf[2] = 0x5a;
+	buf[3] = bytes >> 24;
+	buf[4] = bytes >> 16;
+	buf[5] = bytes >> 8;
+	buf[6] = bytes;
+	return 7;
+}
+
+//Separator written in front of element idx (JSON) or after each element (CSV)
+static inline int fmtSepBefore(char *buf, unsigned int idx, edyht_fmt_t fmt){
+	if((fmt == EDYHT_FMT_JSON) && (idx != 0)){
+		buf[0] = ',';
+		return 1;
+	}
+	return 0;
+}
+
+static inline int fmtSepAfter(char *buf, edyht_fmt_t fmt){
+	if(fmt == EDYHT_FMT_CSV){
+		buf[0] = '\r';
+		buf[1] = '\n';
+		return 2;
+	}
+	return 0;
+}
+
+#define ELEMENT_MAX  (EDYHT_FMT_MAX + 3)
+
+unsigned int edyht_write_int_array_part(edyht_writer_t *w, const int *vals, unsigned int n, unsigned int start, edyht_fmt_t fmt){
+	unsigned int i;
+	for(i = start; (i < n) && (edyht_write_space(w) >= ELEMENT_MAX); i++){
+		char *buf = edyht_write_reserve(w, ELEMENT_MAX);
+		int len = fmtSepBefore(buf, i, fmt);
+		len += edyht_fmt_int(&buf[len], vals[i]);
+		len += fmtSepAfter(&buf[len], fmt);
+		edyht_write_commit(w, len);
+	}
+	return i;
+}
+
+unsigned int edyht_write_uint_array_part(edyht_writer_t *w, const unsigned int *vals, unsigned int n, unsigned int start, edyht_fmt_t fmt){
+	unsigned int i;
+	for(i = start; (i < n) && (edyht_write_space(w) >= ELEMENT_MAX); i++){
+		char *buf = edyht_write_reserve(w, ELEMENT_MAX);
+		int len = fmtSepBefore(buf, i, fmt);
+		len += edyht_fmt_uint(&buf[len], vals[i]);
+		len += fmtSepAfter(&buf[len], fmt);
+		edyht_write_commit(w, len);
+	}
+	return i;
+}
+
+unsigned int edyht_write_fix_array_part(edyht_writer_t *w, const int *vals, unsigned int n, unsigned int start, unsigned int frac, edyht_fmt_t fmt){
+	unsigned int i;
+	for(i = start; (i < n) && (edyht_write_space(w) >= ELEMENT_MAX); i++){
+		char *buf = edyht_write_reserve(w, ELEMENT_MAX);
+		int len = fmtSepBefore(buf, i, fmt);
+		len += edyht_fmt_fix(&buf[len], vals[i], frac);
+		len += fmtSepAfter(&buf[len], fmt);
+		edyht_write_commit(w, len);
+	}
+	return i;
+}
+
+unsigned int edyht_write_float_array_part(edyht_writer_t *w, const float *vals, unsigned int n, unsigned int start, unsigned int decimals, edyht_fmt_t fmt){
+	unsigned int i;
+	for(i = start; (i < n) && (edyht_write_space(w) >= ELEMENT_MAX); i++){
+		char *buf = edyht_write_reserve(w, ELEMENT_MAX);
+		int len = fmtSepBefore(buf, i, fmt);
+		int numLen = edyht_fmt_float(&buf[len], vals[i], decimals);
+		if((numLen == 0) && (fmt == EDYHT_FMT_JSON)){
+			memcpy(&buf[len], "null", 4); //not representable
+			numLen = 4;
+		}
+		len += numLen;
+		len += fmtSepAfter(&buf[len], fmt);
+		edyht_write_commit(w, len);
+	}
+	return i;
+}
+
+//Complete arrays: continue in the next buffer when the current one is full
+void edyht_write_int_array(edyht_writer_t *w, const int *vals, unsigned int n, edyht_fmt_t fmt){
+	unsigned int i = 0;
+	while(i < n){
+		edyht_write_reserve(w, ELEMENT_MAX); //flushes if full
+		i = edyht_write_int_array_part(w, vals, n, i, fmt);
+	}
+}
+
+void edyht_write_uint_array(edyht_writer_t *w, const unsigned int *vals, unsigned int n, edyht_fmt_t fmt){
+	unsigned int i = 0;
+	while(i < n){
+		edyht_write_reserve(w, ELEMENT_MAX);
+		i = edyht_write_uint_array_part(w, vals, n, i, fmt);
+	}
+}
+
+void edyht_write_fix_array(edyht_writer_t *w, const int *vals, unsigned int n, unsigned int frac, edyht_fmt_t fmt){
+	unsigned int i = 0;
+	while(i < n){
+		edyht_write_reserve(w, ELEMENT_MAX);
+		i = edyht_write_fix_array_part(w, vals, n, i, frac, fmt);
+	}
+}
+
+void edyht_write_float_array(edyht_writer_t *w, const float *vals, unsigned int n, unsigned int decimals, edyht_fmt_t fmt){
+	unsigned int i = 0;
+	while(i < n){
+		edyht_write_reserve(w, ELEMENT_MAX);
+		i = edyht_write_float_array_part(w, vals, n, i, decimals, fmt);
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef __EDYHT_FMT_H__
+#define __EDYHT_FMT_H__
+
+#include "edyht.h"
+
+/* Max. number of chars written by a single edyht_fmt_* call, worst case
+ * is a float: sign, 20 integer digits, "." and 9 decimals */
+#define EDYHT_FMT_MAX  32
+
+typedef enum {
+	EDYHT_FMT_JSON,   //values separated by ",", caller writes the brackets
+	EDYHT_FMT_CSV,    //one value per line
+	EDYHT_FMT_CBOR,   //binary, array endpoints only: typed array (RFC 8746)
+	EDYHT_FMT_RAW,    //binary, array endpoints only: header + values
+} edyht_fmt_t;
+
+static inline int edyht_fmt_binary(edyht_fmt_t fmt){
+	return (fmt == EDYHT_FMT_CBOR) || (fmt == EDYHT_FMT_RAW);
+}
+
+/* Max. length of a binary array header */
+#define EDYHT_FMT_BIN_HDR  8
+
+/* Number to ASCII conversion, no terminating "0", return number of chars */
+int edyht_fmt_uint(char *buf, unsigned int val);
+int edyht_fmt_int(char *buf, int val);
+int edyht_fmt_fix(char *buf, int val, unsigned int frac);            //val / 10^frac, frac <= 9
+int edyht_fmt_float(char *buf, float val, unsigned int decimals);    //decimals <= 9, 0 if not finite / out of range
+
+/* Header in front of n little endian values of type in a binary format,
+ * returns its length. Raw: type (edyht_elem_t), bytes per value, header
+ * length (2 bytes) and n (4 bytes), all little endian. */
+int edyht_fmt_array_header(unsigned char *buf, edyht_fmt_t fmt, edyht_elem_t type, unsigned int n);
+
+/* Stream arrays of samples directly into the response buffer */
+void edyht_write_int_array(edyht_writer_t *w, const int *vals, unsigned int n, edyht_fmt_t fmt);
+void edyht_write_uint_array(edyht_writer_t *w, const unsigned int *vals, unsigned int n, edyht_fmt_t fmt);
+void edyht_write_fix_array(edyht_writer_t *w, const int *vals, unsigned int n, unsigned int frac, edyht_fmt_t fmt);
+void edyht_write_float_array(edyht_writer_t *w, const float *vals, unsigned int n, unsigned int decimals, edyht_fmt_t fmt);
+
+/* Streaming variants for providers (edyht_register_stream): write
+ * vals[start..n-1] as far as they fit into the current chunk and return the
+ * index of the first value not written */
+unsigned int edyht_write_int_array_part(edyht_writer_t *w, const int *vals, unsigned int n, unsigned int start, edyht_fmt_t fmt);
+unsigned int edyht_write_uint_array_part(edyht_writer_t *w, const unsigned int *vals, unsigned int n, unsigned int start, edyht_fmt_t fmt);
+unsigned int edyht_write_fix_array_part(edyht_writer_t *w, const int *vals, unsigned int n, unsigned int start, unsigned int frac, edyht_fmt_t fmt);
+unsigned int edyht_write_float_array_part(edyht_writer_t *w, const float *vals, unsigned int n, unsigned int start, unsigned int decimals, edyht_fmt_t fmt);
+
+#endif // __EDYHT_FMT_H__
@@ -0,0 +1,120 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht_form.c
+ * @brief edyht - incremental decoder of urlencoded form bodies
+ * @copyright BSD 2-Clause License
+ *
+ * Decodes "+" and "%XX" while the body arrives and hands each field to the
+ * application as soon as its "&" (or the end of the body) is seen. RAM is
+ * one field buffer, whatever the size of the body.
+ *
+ */
+
+#include <string.h>
+
+#include "edyht_form.h"
+
+void edyht_form_init(edyht_form_t *f, edyht_form_field_t field){
+	f->field = field;
+	f->len = 0;
+	f->valueStart = 0;
+	f->hex = 0;
+	f->hexVal = 0;
+}
+
+static int hexDigit(char c){
+	if((c >= '0') && (c <= '9')) return c - '0';
+	if((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+	if((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+	return -1;
+}
+
+//Append a decoded char, one byte stays free for the terminating "0"
+static inline int put(edyht_form_t *f, char c){
+	if(f->len >= sizeof(f->buf) - 1) return EDYHT_FORM_ERR_SIZE;
+	f->buf[f->len++] = c;
+	return EDYHT_FORM_OK;
+}
+
+static int fieldEnd(edyht_form_t *f){
+	const char *value;
+
+	if((f->len == 0) && (f->valueStart == 0)) return EDYHT_FORM_OK; //empty, e.g. "a=1&&b=2"
+	f->buf[f->len] = '\0';
+	value = f->valueStart ? &f->buf[f->valueStart] : &f->buf[f->len]; //name only: empty value
+	f->len = 0;
+	f->valueStart = 0;
+	return f->field(f->buf, value) ? EDYHT_FORM_OK : EDYHT_FORM_ERR_REJECT;
+}
+
+int edyht_form_feed(edyht_form_t *f, const char *data, unsigned int len){
+	unsigned int pos;
+	int ret = EDYHT_FORM_OK;
+
+	for(pos = 0; (pos < len) && (ret == EDYHT_FORM_OK); pos++){
+		char c = data[pos];
+
+		if(f->hex){
+			int d = hexDigit(c);
+			if(d < 0) return EDYHT_FORM_ERR_CHAR;
+			f->hexVal = (f->hexVal << 4) | d;
+			if(--f->hex > 0) continue;
+			if(f->hexVal == 0) return EDYHT_FORM_ERR_CHAR; //would end the string
+			ret = put(f, f->hexVal);
+			continue;
+		}
+		switch(c){
+		case '&':
+			ret = fieldEnd(f);
+			break;
+		case '=':
+			if(f->valueStart != 0){
+				ret = put(f, c);
+				break;
+			}
+			ret = put(f, '\0');
+			f->valueStart = f->len;
+			break;
+		case '%':
+			f->hex = 2;
+			f->hexVal = 0;
+			break;
+		case '+':
+			ret = put(f, ' ');
+			break;
+		default:
+			ret = put(f, c);
+			break;
+		}
+	}
+	return ret;
+}
+
+int edyht_form_end(edyht_form_t *f){
+	if(f->hex) return EDYHT_FORM_ERR_CHAR;
+	return fieldEnd(f);
+}
@@ -0,0 +1,34 @@
+#ifndef __EDYHT_FORM_H__
+#define __EDYHT_FORM_H__
+
+#include <stdint.h>
+#include "edyht.h"
+
+#define EDYHT_FORM_OK           0
+#define EDYHT_FORM_ERR_SIZE    -1  //field longer than EDYHT_FORM_FIELD_LEN
+#define EDYHT_FORM_ERR_CHAR    -2  //invalid "%" escape or "%00"
+#define EDYHT_FORM_ERR_REJECT  -3  //field callback returned 0
+
+/* Incremental application/x-www-form-urlencoded decoder, one per
+ * connection. Only the field being received is kept in buf, name and
+ * value decoded. */
+typedef struct {
+	edyht_form_field_t field;
+	unsigned int len;           //chars in buf
+	unsigned int valueStart;    //index of the value in buf, 0: no "=" yet
+	uint8_t hex;                //hex digits of a "%XX" escape still expected
+	uint8_t hexVal;
+	char buf[EDYHT_FORM_FIELD_LEN];
+} edyht_form_t;
+
+void edyht_form_init(edyht_form_t *f, edyht_form_field_t field);
+
+/* Feed body data in pieces of any size, field is called for each complete
+ * field. Returns EDYHT_FORM_OK or an error, the decoder must not be fed
+ * after an error. */
+int edyht_form_feed(edyht_form_t *f, const char *data, unsigned int len);
+
+//End of the body, passes the last field
+int edyht_form_end(edyht_form_t *f);
+
+#endif // __EDYHT_FORM_H__
@@ -0,0 +1,211 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht_lwipstats.c
+ * @brief edyht - lwIP statistics as JSON and HTML
+ * @copyright BSD 2-Clause License
+ *
+ * Single pass over lwip_stats, every value goes directly into the response
+ * buffer. Delta mode keeps the counters of the previous delta request of
+ * any client, each counter is read and updated under SYS_ARCH_PROTECT so that
+ * concurrent delta requests split a change instead of both reporting it.
+ *
+ */
+
+#include <string.h>
+
+#include "lwip/opt.h"
+#include "lwip/stats.h"
+#include "lwip/sys.h"
+#include "edyht_lwipstats.h"
+#include "edyht_fmt.h"
+
+typedef struct {
+	edyht_writer_t *w;
+	u8_t html;
+	u8_t delta;
+	u8_t first;                  //no "," before the next JSON member
+} out_t;
+
+#if LWIP_STATS
+//Counters at the previous delta request
+static struct stats_ last;
+#if MEMP_STATS
+static struct stats_mem lastMemp[MEMP_MAX];
+
+static const char * const mempNames[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name, num, size, desc) #name,
+#include "lwip/priv/memp_std.h"
+};
+#endif
+
+static void groupBegin(out_t *o, const char *name){
+	if(o->html){
+		edyht_printf(o->w, "<tr><th colspan=\"2\">%s</th></tr>\n", name);
+	}
+	else{
+		edyht_printf(o->w, "%s\"%s\":{", o->first ? "" : ",", name);
+	}
+	o->first = 1;
+}
+
+static void groupEnd(out_t *o){
+	if(!o->html) edyht_write_const(o->w, "}", 1);
+	o->first = 0;
+}
+
+static void valueWrite(out_t *o, const char *name, u32_t val){
+	unsigned int len = strlen(name);
+	char *buf = edyht_write_reserve(o->w, len + EDYHT_FMT_MAX + 24);
+	char *p = buf;
+
+	if(o->html){
+		memcpy(p, "<tr><td>", 8); p += 8;
+		memcpy(p, name, len); p += len;
+		memcpy(p, "</td><td>", 9); p += 9;
+		p += edyht_fmt_uint(p, val);
+		memcpy(p, "</td></tr>\n", 11); p += 11;
+	}
+	else{
+		if(!o->first) *p++ = ',';
+		*p++ = '"';
+		memcpy(p, name, len); p += len;
+		*p++ = '"';
+		*p++ = ':';
+		p += edyht_fmt_uint(p, val);
+	}
+	o->first = 0;
+	edyht_write_commit(o->w, p - buf);
+}
+
+//Counter value, in delta mode the change since the previous delta request
+static inline u32_t counter(const out_t *o, const STAT_COUNTER *cur, STAT_COUNTER *prev){
+	STAT_COUNTER c, d;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	if(!o->delta) return *cur;
+	SYS_ARCH_PROTECT(lev);
+	c = *cur;
+	d = c - *prev;
+	*prev = c;
+	SYS_ARCH_UNPROTECT(lev);
+	return d;
+}
+
+static void protoWrite(out_t *o, const char *name, const struct stats_proto *p, struct stats_proto *prev){
+	groupBegin(o, name);
+	valueWrite(o, "xmit",     counter(o, &p->xmit,     &prev->xmit));
+	valueWrite(o, "recv",     counter(o, &p->recv,     &prev->recv));
+	valueWrite(o, "fw",       counter(o, &p->fw,       &prev->fw));
+	valueWrite(o, "drop",     counter(o, &p->drop,     &prev->drop));
+	valueWrite(o, "chkerr",   counter(o, &p->chkerr,   &prev->chkerr));
+	valueWrite(o, "lenerr",   counter(o, &p->lenerr,   &prev->lenerr));
+	valueWrite(o, "memerr",   counter(o, &p->memerr,   &prev->memerr));
+	valueWrite(o, "rterr",    counter(o, &p->rterr,    &prev->rterr));
+	valueWrite(o, "proterr",  counter(o, &p->proterr,  &prev->proterr));
+	valueWrite(o, "opterr",   counter(o, &p->opterr,   &prev->opterr));
+	valueWrite(o, "err",      counter(o, &p->err,      &prev->err));
+	valueWrite(o, "cachehit", counter(o, &p->cachehit, &prev->cachehit));
+	groupEnd(o);
+}
+
+static void memWrite(out_t *o, const char *name, const struct stats_mem *m, struct stats_mem *prev){
+	groupBegin(o, name);
+	valueWrite(o, "avail",   m->avail);
+	valueWrite(o, "used",    m->used);
+	valueWrite(o, "max",     m->max);
+	valueWrite(o, "err",     counter(o, &m->err,     &prev->err));
+	valueWrite(o, "illegal", counter(o, &m->illegal, &prev->illegal));
+	groupEnd(o);
+}
+
+static void sysWrite(out_t *o, const char *name, const struct stats_syselem *s, struct stats_syselem *prev){
+	groupBegin(o, name);
+	valueWrite(o, "used", s->used);
+	valueWrite(o, "max",  s->max);
+	valueWrite(o, "err",  counter(o, &s->err, &prev->err));
+	groupEnd(o);
+}
+#endif
+
+static void statsWrite(edyht_writer_t *w, u8_t html){
+#if LWIP_STATS
+	const char *delta = edyht_query_get(w, "delta");
+	out_t o = { w, html, (delta != NULL) && (delta[0] == '1'), 1 };
+#endif
+
+	if(!html) edyht_write_const(w, "{", 1);
+#if LINK_STATS
+	protoWrite(&o, "link", &lwip_stats.link, &last.link);
+#endif
+#if ETHARP_STATS
+	protoWrite(&o, "etharp", &lwip_stats.etharp, &last.etharp);
+#endif
+#if IP_STATS
+	protoWrite(&o, "ip", &lwip_stats.ip, &last.ip);
+#endif
+#if ICMP_STATS
+	protoWrite(&o, "icmp", &lwip_stats.icmp, &last.icmp);
+#endif
+#if UDP_STATS
+	protoWrite(&o, "udp", &lwip_stats.udp, &last.udp);
+#endif
+#if TCP_STATS
+	protoWrite(&o, "tcp", &lwip_stats.tcp, &last.tcp);
+#endif
+#if MEM_STATS
+	memWrite(&o, "mem", &lwip_stats.mem, &last.mem);
+#endif
+#if MEMP_STATS
+	{
+		unsigned int i;
+		groupBegin(&o, "memp");
+		for(i = 0; i < MEMP_MAX; i++){
+			if(lwip_stats.memp[i] == NULL) continue;
+			memWrite(&o, mempNames[i], lwip_stats.memp[i], &lastMemp[i]);
+		}
+		groupEnd(&o);
+	}
+#endif
+#if SYS_STATS
+	groupBegin(&o, "sys");
+	sysWrite(&o, "sem",   &lwip_stats.sys.sem,   &last.sys.sem);
+	sysWrite(&o, "mutex", &lwip_stats.sys.mutex, &last.sys.mutex);
+	sysWrite(&o, "mbox",  &lwip_stats.sys.mbox,  &last.sys.mbox);
+	groupEnd(&o);
+#endif
+	if(!html) edyht_write_const(w, "}", 1);
+}
+
+void edyht_lwipstats_json(edyht_writer_t *w){
+	statsWrite(w, 0);
+}
+
+void edyht_lwipstats_html(edyht_writer_t *w){
+	edyht_write_const(w, "<table>\n", 8);
+	statsWrite(w, 1);
+	edyht_write_const(w, "</table>\n", 9);
+}
@@ -0,0 +1,14 @@
+#ifndef __EDYHT_LWIPSTATS_H__
+#define __EDYHT_LWIPSTATS_H__
+
+#include "edyht.h"
+
+/* Page handlers for lwip_stats (link, etharp, ip, icmp, udp, tcp, mem, memp,
+ * sys as far as enabled in lwipopts.h), written field by field into the
+ * response. With the query "delta=1" counters show the change since the
+ * previous delta request of any client, e.g. drops and pool errors per
+ * refresh of a single monitor; avail/used/max are always absolute. */
+void edyht_lwipstats_json(edyht_writer_t *w);
+void edyht_lwipstats_html(edyht_writer_t *w); //table for the body of lwip.htm
+
+#endif // __EDYHT_LWIPSTATS_H__
@@ -0,0 +1,222 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht_metrics.c
+ * @brief edyht - request counters and latency histograms
+ * @copyright BSD 2-Clause License
+ *
+ * Counters per route slot and per status code, updated once per request
+ * under SYS_ARCH_PROTECT. Latency histograms use power of 2 buckets of
+ * EDYHT_METRICS_CLOCK() ticks, so recording is a count leading zeros and
+ * a few increments.
+ *
+ */
+
+#include <string.h>
+
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+#include "edyht_metrics.h"
+#include "edyht_parse.h"
+#include "edyht_fmt.h"
+
+#if EDYHT_METRICS
+
+typedef struct {
+	const char *name;
+	uint32_t requests;
+	uint32_t bytes;
+	uint64_t ticks;                      //sum of durations
+	uint32_t hist[EDYHT_METRICS_BUCKETS];  //[b]: duration < 2^(b + EDYHT_METRICS_BUCKET_SHIFT) ticks, last: all others
+} routeMetrics_t;
+
+static routeMetrics_t routes[EDYHT_METRICS_ROUTES] = {
+		[EDYHT_METRICS_OTHER] = { .name = "_other" },
+};
+static uint8_t routeCount = 1;
+
+static const uint16_t statusCodes[] = { 101, 200, 304, 400, 404, 500, 501, 503 };
+#define STATUS_COUNT  (sizeof(statusCodes)/sizeof(statusCodes[0]))
+static uint32_t statusCount[STATUS_COUNT];
+
+static const char * const parseErrNames[] = { "request", "overflow", "wrongchar" }; //-CHARPROC_ERR_* - 1
+static uint32_t parseErrCount[3];
+
+static const char * const connNames[EDYHT_METRIC_COUNT] = {
+		[EDYHT_METRIC_ACCEPTED] = "accepted",
+		[EDYHT_METRIC_TIMEOUT]  = "timeout",
+		[EDYHT_METRIC_ERROR]    = "error",
+		[EDYHT_METRIC_ABORTED]  = "aborted",
+		[EDYHT_METRIC_REJECTED] = "rejected",
+		[EDYHT_METRIC_HEADER_TIMEOUT] = "header_timeout",
+		[EDYHT_METRIC_BUDGET]   = "budget",
+		[EDYHT_METRIC_CACHE_HIT]  = "hit",
+		[EDYHT_METRIC_CACHE_MISS] = "miss",
+};
+static uint32_t connCount[EDYHT_METRIC_COUNT];
+
+uint8_t edyht_metrics_route(const char *name){
+	if(routeCount >= EDYHT_METRICS_ROUTES) return EDYHT_METRICS_OTHER;
+	routes[routeCount].name = name;
+	return routeCount++;
+}
+
+static inline unsigned int bucket(uint32_t ticks){
+	unsigned int b;
+	ticks >>= EDYHT_METRICS_BUCKET_SHIFT;
+	b = (ticks == 0) ? 0 : 32 - __builtin_clz(ticks);
+	return (b < EDYHT_METRICS_BUCKETS) ? b : EDYHT_METRICS_BUCKETS - 1;
+}
+
+static inline void statusCountInc(unsigned int status){
+	unsigned int i;
+	for(i = 0; i < STATUS_COUNT; i++){
+		if(statusCodes[i] == status){
+			statusCount[i]++;
+			break;
+		}
+	}
+}
+
+void edyht_metrics_request(uint8_t slot, unsigned int status, uint32_t bytes, uint32_t ticks){
+	routeMetrics_t *r = &routes[slot];
+	unsigned int b = bucket(ticks);
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	r->requests++;
+	r->bytes += bytes;
+	r->ticks += ticks;
+	r->hist[b]++;
+	statusCountInc(status);
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+void edyht_metrics_bytes(uint8_t slot, uint32_t bytes){
+	SYS_ARCH_INC(routes[slot].bytes, bytes);
+}
+
+void edyht_metrics_parse_error(int code){
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	if((code <= CHARPROC_ERR_REQUEST) && (code >= CHARPROC_ERR_WRONGCHAR)) parseErrCount[-code - 1]++;
+	statusCountInc(400);
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+void edyht_metrics_count(edyht_metric_t m){
+	SYS_ARCH_INC(connCount[m], 1);
+}
+
+//Clock ticks as seconds with 9 decimals, exact for the bucket bounds
+static void secondsWrite(edyht_writer_t *w, uint64_t ticks){
+	uint32_t sec = (uint32_t)(ticks / EDYHT_METRICS_CLOCK_HZ);
+	uint32_t ns = (uint32_t)((ticks % EDYHT_METRICS_CLOCK_HZ) * 1000000000ull / EDYHT_METRICS_CLOCK_HZ);
+	edyht_printf(w, "%lu.%09lu", (unsigned long)sec, (unsigned long)ns);
+}
+
+void edyht_metrics_prometheus(edyht_writer_t *w){
+	unsigned int i, b;
+
+	edyht_printf(w, "# TYPE edyht_requests_total counter\n");
+	for(i = 0; i < routeCount; i++){
+		if(routes[i].requests == 0) continue;
+		edyht_printf(w, "edyht_requests_total{route=\"%s\"} %lu\n", routes[i].name, (unsigned long)routes[i].requests);
+	}
+	edyht_printf(w, "# TYPE edyht_sent_bytes_total counter\n");
+	for(i = 0; i < routeCount; i++){
+		if(routes[i].requests == 0) continue;
+		edyht_printf(w, "edyht_sent_bytes_total{route=\"%s\"} %lu\n", routes[i].name, (unsigned long)routes[i].bytes);
+	}
+	edyht_printf(w, "# TYPE edyht_request_duration_seconds histogram\n");
+	for(i = 0; i < routeCount; i++){
+		const routeMetrics_t *r = &routes[i];
+		uint32_t sum = 0;
+		if(r->requests == 0) continue;
+		for(b = 0; b < EDYHT_METRICS_BUCKETS - 1; b++){
+			sum += r->hist[b];
+			edyht_printf(w, "edyht_request_duration_seconds_bucket{route=\"%s\",le=\"", r->name);
+			secondsWrite(w, 1ull << (b + EDYHT_METRICS_BUCKET_SHIFT));
+			edyht_printf(w, "\"} %lu\n", (unsigned long)sum);
+		}
+		edyht_printf(w, "edyht_request_duration_seconds_bucket{route=\"%s\",le=\"+Inf\"} %lu\n", r->name, (unsigned long)r->requests);
+		edyht_printf(w, "edyht_request_duration_seconds_sum{route=\"%s\"} ", r->name);
+		secondsWrite(w, r->ticks);
+		edyht_printf(w, "\nedyht_request_duration_seconds_count{route=\"%s\"} %lu\n", r->name, (unsigned long)r->requests);
+	}
+	edyht_printf(w, "# TYPE edyht_responses_total counter\n");
+	for(i = 0; i < STATUS_COUNT; i++){
+		edyht_printf(w, "edyht_responses_total{code=\"%u\"} %lu\n", statusCodes[i], (unsigned long)statusCount[i]);
+	}
+	edyht_printf(w, "# TYPE edyht_parse_errors_total counter\n");
+	for(i = 0; i < 3; i++){
+		edyht_printf(w, "edyht_parse_errors_total{error=\"%s\"} %lu\n", parseErrNames[i], (unsigned long)parseErrCount[i]);
+	}
+	edyht_printf(w, "# TYPE edyht_connections_total counter\n");
+	for(i = 0; i < EDYHT_METRIC_CACHE_HIT; i++){
+		edyht_printf(w, "edyht_connections_total{event=\"%s\"} %lu\n", connNames[i], (unsigned long)connCount[i]);
+	}
+	edyht_printf(w, "# TYPE edyht_cache_total counter\n");
+	for(i = EDYHT_METRIC_CACHE_HIT; i < EDYHT_METRIC_COUNT; i++){
+		edyht_printf(w, "edyht_cache_total{result=\"%s\"} %lu\n", connNames[i], (unsigned long)connCount[i]);
+	}
+}
+
+void edyht_metrics_json(edyht_writer_t *w){
+	unsigned int i;
+
+	edyht_printf(w, "{\"clock_hz\":%lu,\"bucket_shift\":%u,\"routes\":[",
+			(unsigned long)EDYHT_METRICS_CLOCK_HZ, (unsigned int)EDYHT_METRICS_BUCKET_SHIFT);
+	for(i = 0; i < routeCount; i++){
+		const routeMetrics_t *r = &routes[i];
+		edyht_printf(w, "%s{\"route\":\"%s\",\"requests\":%lu,\"bytes\":%lu,\"seconds\":",
+				(i > 0) ? "," : "", r->name, (unsigned long)r->requests, (unsigned long)r->bytes);
+		secondsWrite(w, r->ticks);
+		edyht_write_const(w, ",\"hist\":[", 9);
+		edyht_write_uint_array(w, (const unsigned int*)r->hist, EDYHT_METRICS_BUCKETS, EDYHT_FMT_JSON);
+		edyht_write_const(w, "]}", 2);
+	}
+	edyht_write_const(w, "],\"status\":{", 12);
+	for(i = 0; i < STATUS_COUNT; i++){
+		edyht_printf(w, "%s\"%u\":%lu", (i > 0) ? "," : "", statusCodes[i], (unsigned long)statusCount[i]);
+	}
+	edyht_write_const(w, "},\"parse_errors\":{", 18);
+	for(i = 0; i < 3; i++){
+		edyht_printf(w, "%s\"%s\":%lu", (i > 0) ? "," : "", parseErrNames[i], (unsigned long)parseErrCount[i]);
+	}
+	edyht_write_const(w, "},\"connections\":{", 17);
+	for(i = 0; i < EDYHT_METRIC_CACHE_HIT; i++){
+		edyht_printf(w, "%s\"%s\":%lu", (i > 0) ? "," : "", connNames[i], (unsigned long)connCount[i]);
+	}
+	edyht_write_const(w, "},\"cache\":{", 11);
+	for(i = EDYHT_METRIC_CACHE_HIT; i < EDYHT_METRIC_COUNT; i++){
+		edyht_printf(w, "%s\"%s\":%lu", (i > EDYHT_METRIC_CACHE_HIT) ? "," : "", connNames[i], (unsigned long)connCount[i]);
+	}
+	edyht_write_const(w, "}}", 2);
+}
+
+#endif //EDYHT_METRICS
@@ -0,0 +1,59 @@
+#ifndef __EDYHT_METRICS_H__
+#define __EDYHT_METRICS_H__
+
+#include <stdint.h>
+#include "edyht.h"
+
+#ifndef EDYHT_METRICS_CLOCK
+#define EDYHT_METRICS_CLOCK()   sys_now()
+#undef EDYHT_METRICS_CLOCK_HZ
+#define EDYHT_METRICS_CLOCK_HZ  1000
+#endif
+
+//Connection and response cache events
+typedef enum {
+	EDYHT_METRIC_ACCEPTED,
+	EDYHT_METRIC_TIMEOUT,       //closed by receive / idle timeout
+	EDYHT_METRIC_ERROR,         //closed by a receive or connection error
+	EDYHT_METRIC_ABORTED,       //client did not take the response
+	EDYHT_METRIC_REJECTED,      //over EDYHT_MAX_CONNS, answered with 503
+	EDYHT_METRIC_HEADER_TIMEOUT, //headers not complete within EDYHT_HEADER_TIMEOUT
+	EDYHT_METRIC_BUDGET,        //closed after EDYHT_CONN_BUDGET
+	EDYHT_METRIC_CACHE_HIT,     //response sent from the cache
+	EDYHT_METRIC_CACHE_MISS,    //cached route, handler called
+	EDYHT_METRIC_COUNT
+} edyht_metric_t;
+
+#define EDYHT_METRICS_OTHER  0  //slot of requests without route (404, bad requests)
+
+#if EDYHT_METRICS
+
+/* Counter slot for a new route, the "other" slot when all are used */
+uint8_t edyht_metrics_route(const char *name);
+
+/* One request served: status code, bytes sent and duration in clock ticks */
+void edyht_metrics_request(uint8_t slot, unsigned int status, uint32_t bytes, uint32_t ticks);
+
+/* Data sent later on behalf of a route (streams, events, WebSocket frames) */
+void edyht_metrics_bytes(uint8_t slot, uint32_t bytes);
+
+void edyht_metrics_parse_error(int code);   //CHARPROC_ERR_*, answered with 400
+void edyht_metrics_count(edyht_metric_t m);
+
+/* Page handlers: Prometheus text format and JSON */
+void edyht_metrics_prometheus(edyht_writer_t *w);
+void edyht_metrics_json(edyht_writer_t *w);
+
+#else
+
+static inline uint8_t edyht_metrics_route(const char *name){ (void)name; return EDYHT_METRICS_OTHER; }
+static inline void edyht_metrics_request(uint8_t slot, unsigned int status, uint32_t bytes, uint32_t ticks){
+	(void)slot; (void)status; (void)bytes; (void)ticks;
+}
+static inline void edyht_metrics_bytes(uint8_t slot, uint32_t bytes){ (void)slot; (void)bytes; }
+static inline void edyht_metrics_parse_error(int code){ (void)code; }
+static inline void edyht_metrics_count(edyht_metric_t m){ (void)m; }
+
+#endif
+
+#endif // __EDYHT_METRICS_H__
@@ -0,0 +1,354 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht_parse.c
+ * @brief edyht - HTTP request parser
+ * @copyright BSD 2-Clause License
+ *
+ * Reentrant parser taking whole receive segments. Lines are located with
+ * memchr and copied into the per-connection buffer, the request line is
+ * split with a character class table. Only the request line and the
+ * headers listed in edyht_hdr_t are kept, other header lines are dropped
+ * as soon as they are complete.
+ *
+ */
+
+#include <string.h>
+#include <ctype.h>
+
+#include "edyht_parse.h"
+
+#define CC_PATH    0x01
+#define CC_QNAME   0x02
+#define CC_QVAL    0x04
+
+//Allowed characters of path, query names and query values, '+' in values is decoded to ' '
+static const uint8_t charClass[256] = {
+		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,   //0x00
+		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,   //0x10
+		0,0,0,0,0,0,0,0,0,0,0,4,0,5,7,1,   //0x20
+		7,7,7,7,7,7,7,7,7,7,0,0,0,0,0,0,   //0x30
+		0,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,   //0x40
+		7,7,7,7,7,7,7,7,7,7,7,0,0,0,0,7,   //0x50
+		0,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,   //0x60
+		7,7,7,7,7,7,7,7,7,7,7,0,0,0,0,0,   //0x70
+};
+
+//Lower case names, index is edyht_hdr_t
+static const struct {
+	const char *name;
+	unsigned int len;
+} hdrNames[EDYHT_HDR_COUNT] = {
+		[EDYHT_HDR_HOST]            = { "host",            4 },
+		[EDYHT_HDR_CONNECTION]      = { "connection",      10 },
+		[EDYHT_HDR_ACCEPT]          = { "accept",          6 },
+		[EDYHT_HDR_ACCEPT_ENCODING] = { "accept-encoding", 15 },
+		[EDYHT_HDR_IF_NONE_MATCH]   = { "if-none-match",   13 },
+		[EDYHT_HDR_RANGE]           = { "range",           5 },
+		[EDYHT_HDR_UPGRADE]         = { "upgrade",         7 },
+		[EDYHT_HDR_WS_KEY]          = { "sec-websocket-key", 17 },
+		[EDYHT_HDR_WS_VERSION]      = { "sec-websocket-version", 21 },
+		[EDYHT_HDR_CONTENT_LENGTH]  = { "content-length",  14 },
+		[EDYHT_HDR_CONTENT_TYPE]    = { "content-type",    12 },
+		[EDYHT_HDR_EXPECT]          = { "expect",          6 },
+		[EDYHT_HDR_TRANSFER_ENCODING] = { "transfer-encoding", 17 },
+};
+
+void edyht_parse_init(edyht_req_t *p){
+	int i;
+
+	p->method = EDYHT_METHOD_OTHER;
+	p->path = NULL;
+	p->pathHash = FNV_OFFSET;
+	p->http11 = 0;
+	p->keepAlive = 0;
+	p->reqLine = 0;
+	p->skip = 0;
+	p->queryCount = 0;
+	for(i = 0; i < EDYHT_HDR_COUNT; i++) p->hdr[i] = NULL;
+	p->fill = 0;
+	p->lineStart = 0;
+}
+
+//Case insensitive compare of s with lower case token of length n
+static int tokenEqual(const char *s, const char *token, unsigned int n){
+	while(n--){
+		if(tolower((unsigned char)*s++) != *token++) return 0;
+	}
+	return 1;
+}
+
+//True if the ";q=" parameter of a list element is 0, s points behind the token
+static int qualityZero(const char *s, unsigned int n){
+	const char *q;
+
+	for(q = s + 1; q + 2 <= s + n; q++){
+		if(((q[0] == 'q') || (q[0] == 'Q')) && (q[1] == '=') && ((q[-1] == ';') || (q[-1] == ' '))){
+			q += 2;
+			if(*q++ != '0') return 0;
+			if((q < s + n) && (*q == '.')){
+				for(q++; (q < s + n) && (*q == '0'); q++);
+			}
+			return (q == s + n) || (*q == ' ') || (*q == ';');
+		}
+	}
+	return 0;
+}
+
+int edyht_parse_accepts(const char *list, const char *token){
+	unsigned int tokenLen = strlen(token);
+	int star = 0;
+
+	if(list == NULL) return 0;
+	while(*list){
+		unsigned int n, len;
+
+		while((*list == ' ') || (*list == '\t') || (*list == ',')) list++;
+		n = strcspn(list, ",");
+		len = strcspn(list, " \t;,");
+		if(len > n) len = n;
+		if((len == tokenLen) && tokenEqual(list, token, len)){
+			return !qualityZero(list + len, n - len);
+		}
+		if((len == 1) && (list[0] == '*')){
+			star = !qualityZero(list + 1, n - 1);
+		}
+		list += n;
+	}
+	return star;
+}
+
+int edyht_parse_etag_match(const char *list, const char *etag){
+	unsigned int etagLen = strlen(etag);
+
+	if(list == NULL) return 0;
+	while(*list){
+		unsigned int n;
+
+		while((*list == ' ') || (*list == '\t') || (*list == ',')) list++;
+		if(*list == '*') return 1;
+		if((list[0] == 'W') && (list[1] == '/')) list += 2; //weak comparison
+		n = strcspn(list, " \t,");
+		if((n == etagLen) && (memcmp(list, etag, n) == 0)) return 1;
+		list += n;
+	}
+	return 0;
+}
+
+//Query after "?", *ps points to the first char and returns the terminating space
+static int queryParse(edyht_req_t *p, char **ps){
+	char *s = *ps;
+
+	while(*s != ' '){
+		edyht_query_t *q;
+
+		if(p->queryCount >= EDYHT_QUERY_MAX) return CHARPROC_ERR_OWFL;
+		q = &p->query[p->queryCount++];
+
+		q->name = s;
+		while(charClass[(unsigned char)*s] & CC_QNAME) s++;
+		q->value = s; //name only: empty value
+		if(*s == '='){
+			*s++ = '\0';
+			q->value = s;
+			while(charClass[(unsigned char)*s] & CC_QVAL){
+				if(*s == '+') *s = ' ';
+				s++;
+			}
+		}
+
+		if(*s == '&'){
+			*s++ = '\0';
+		}
+		else if(*s != ' '){
+			return CHARPROC_ERR_WRONGCHAR;
+		}
+	}
+	*ps = s;
+	return CHARPROC_OK;
+}
+
+//"METHOD /path?query HTTP/1.x", line is "0" terminated
+static int requestLine(edyht_req_t *p, char *s, unsigned int len){
+	const char *sp = memchr(s, ' ', len);
+	unsigned int n;
+	int ret;
+
+	if((sp == NULL) || (sp == s)) return CHARPROC_ERR_REQUEST;
+	n = sp - s;
+	if((n == 3) && (memcmp(s, "GET", 3) == 0)) p->method = EDYHT_METHOD_GET;
+	else if((n == 4) && (memcmp(s, "HEAD", 4) == 0)) p->method = EDYHT_METHOD_HEAD;
+	else if((n == 4) && (memcmp(s, "POST", 4) == 0)) p->method = EDYHT_METHOD_POST;
+	s += n + 1;
+
+	if(*s != '/') return CHARPROC_ERR_REQUEST;
+	s++;
+	p->path = s;
+	while(charClass[(unsigned char)*s] & CC_PATH){
+		p->pathHash = hashStep(p->pathHash, *s);
+		s++;
+	}
+	if(*s == '?'){
+		*s++ = '\0';
+		ret = queryParse(p, &s);
+		if(ret != CHARPROC_OK) return ret;
+	}
+	else if(*s != ' '){
+		return CHARPROC_ERR_WRONGCHAR;
+	}
+	*s++ = '\0';
+
+	if((strlen(s) != 8) || (memcmp(s, "HTTP/1.", 7) != 0)) return CHARPROC_ERR_REQUEST;
+	if((s[7] < '0') || (s[7] > '9')) return CHARPROC_ERR_REQUEST;
+	p->http11 = (s[7] >= '1');
+	p->keepAlive = p->http11;
+	return CHARPROC_OK;
+}
+
+//Header of name s with length n, EDYHT_HDR_COUNT if not evaluated
+static int headerId(const char *s, unsigned int n){
+	int id;
+
+	for(id = 0; id < EDYHT_HDR_COUNT; id++){
+		if((hdrNames[id].len == n) && tokenEqual(s, hdrNames[id].name, n)) break;
+	}
+	return id;
+}
+
+//"Name: value", returns 1 if the line is kept
+static int headerLine(edyht_req_t *p, char *s, unsigned int len){
+	const char *colon = memchr(s, ':', len);
+	char *v, *end;
+	unsigned int n;
+	int id;
+
+	if(colon == NULL) return CHARPROC_ERR_REQUEST;
+	n = colon - s;
+	id = headerId(s, n);
+	if(id == EDYHT_HDR_COUNT) return 0;
+	//a second length may disagree with the first, the body end would be ambiguous
+	if((id == EDYHT_HDR_CONTENT_LENGTH) && (p->hdr[id] != NULL)) return CHARPROC_ERR_REQUEST;
+
+	//trim white space
+	v = s + n + 1;
+	end = s + len;
+	while((*v == ' ') || (*v == '\t')) v++;
+	while((end > v) && ((end[-1] == ' ') || (end[-1] == '\t'))) end--;
+	*end = '\0';
+	p->hdr[id] = v;
+
+	if(id == EDYHT_HDR_CONNECTION){
+		//token list, e.g. "keep-alive, Upgrade"
+		while(*v){
+			while((*v == ' ') || (*v == ',')) v++;
+			n = strcspn(v, " ,");
+			if((n == 5) && tokenEqual(v, "close", 5)) p->keepAlive = 0;
+			v += n;
+		}
+	}
+	return 1;
+}
+
+//Complete line in buf[lineStart..fill-1] incl. "\n"
+static int lineProcess(edyht_req_t *p){
+	char *s = &p->buf[p->lineStart];
+	unsigned int len = p->fill - p->lineStart - 1;
+	int ret;
+
+	if((len > 0) && (s[len-1] == '\r')) len--;
+	s[len] = '\0';
+
+	if(!p->reqLine){
+		if(len == 0){
+			//empty lines before the request line are ignored
+			p->fill = p->lineStart;
+			return CHARPROC_OK;
+		}
+		ret = requestLine(p, s, len);
+		if(ret != CHARPROC_OK) return ret;
+		p->reqLine = 1;
+		p->lineStart = p->fill;
+		return CHARPROC_OK;
+	}
+
+	if(len == 0) return CHARPROC_FINISHED; //empty line: end of header
+
+	ret = headerLine(p, s, len);
+	if(ret < 0) return ret;
+	if(ret) p->lineStart = p->fill;
+	else p->fill = p->lineStart;
+	return CHARPROC_OK;
+}
+
+int edyht_parse(edyht_req_t *p, const char *data, unsigned int len, unsigned int *used){
+	unsigned int pos = 0;
+	int ret = CHARPROC_OK;
+
+	while((pos < len) && (ret == CHARPROC_OK)){
+		const char *s = &data[pos];
+		unsigned int n = len - pos;
+		const char *nl;
+
+		if(p->skip){
+			//rest of a header line that did not fit
+			nl = memchr(s, '\n', n);
+			if(nl == NULL){
+				pos = len;
+				break;
+			}
+			pos += nl - s + 1;
+			p->skip = 0;
+			continue;
+		}
+
+		//copy up to the end of line or as much as fits
+		if(n > EDYHT_REQ_LEN - p->fill) n = EDYHT_REQ_LEN - p->fill;
+		nl = memchr(s, '\n', n);
+		if(nl != NULL) n = nl - s + 1;
+		memcpy(&p->buf[p->fill], s, n);
+		p->fill += n;
+		pos += n;
+
+		if(nl != NULL){
+			ret = lineProcess(p);
+		}
+		else if(p->fill == EDYHT_REQ_LEN){
+			//line does not fit: request line and evaluated headers are an error, other
+			//header lines are ignored. A lost Content-Length would leave the body to be
+			//parsed as the next request.
+			const char *line = &p->buf[p->lineStart];
+			const char *colon = memchr(line, ':', p->fill - p->lineStart);
+			if(!p->reqLine || (colon == NULL) || (headerId(line, colon - line) != EDYHT_HDR_COUNT)){
+				ret = CHARPROC_ERR_OWFL;
+			}
+			p->fill = p->lineStart;
+			p->skip = 1;
+		}
+	}
+
+	*used = pos;
+	return ret;
+}
@@ -0,0 +1,95 @@
+#ifndef __EDYHT_PARSE_H__
+#define __EDYHT_PARSE_H__
+
+#include <stdint.h>
+
+#include "edyht.h"
+
+/* Max. number of query elements of a request */
+#ifndef EDYHT_QUERY_MAX
+#define EDYHT_QUERY_MAX 10
+#endif
+
+#define CHARPROC_OK             0
+#define CHARPROC_FINISHED       1
+#define CHARPROC_ERR_REQUEST   -1
+#define CHARPROC_ERR_OWFL      -2
+#define CHARPROC_ERR_WRONGCHAR -3
+
+#define FNV_OFFSET  2166136261u
+#define FNV_PRIME   16777619u
+
+static inline uint32_t hashStep(uint32_t hash, char c){
+	return (hash ^ (unsigned char)c) * FNV_PRIME;
+}
+
+typedef enum {
+	EDYHT_METHOD_OTHER,
+	EDYHT_METHOD_GET,
+	EDYHT_METHOD_HEAD,
+	EDYHT_METHOD_POST,
+} edyht_method_t;
+
+//Headers evaluated by the server, all others are skipped
+typedef enum {
+	EDYHT_HDR_HOST,
+	EDYHT_HDR_CONNECTION,
+	EDYHT_HDR_ACCEPT,
+	EDYHT_HDR_ACCEPT_ENCODING,
+	EDYHT_HDR_IF_NONE_MATCH,
+	EDYHT_HDR_RANGE,
+	EDYHT_HDR_UPGRADE,
+	EDYHT_HDR_WS_KEY,
+	EDYHT_HDR_WS_VERSION,
+	EDYHT_HDR_CONTENT_LENGTH,
+	EDYHT_HDR_CONTENT_TYPE,
+	EDYHT_HDR_EXPECT,
+	EDYHT_HDR_TRANSFER_ENCODING,
+	EDYHT_HDR_COUNT
+} edyht_hdr_t;
+
+typedef struct {
+	const char *name;
+	const char *value;
+} edyht_query_t;
+
+/* Request parser, one per connection. Data is copied line by line into buf,
+ * all strings of the result are "0" terminated slices of buf and stay valid
+ * until the next edyht_parse_init. */
+typedef struct {
+	edyht_method_t method;
+	const char *path;           //without leading "/"
+	uint32_t pathHash;          //FNV-1a hash of path
+	uint8_t http11;             //request is HTTP/1.1 or later
+	uint8_t keepAlive;          //client allows persistent connection
+	uint8_t reqLine;            //request line is complete
+	uint8_t skip;               //skipping the rest of a header line that does not fit
+	int queryCount;
+	edyht_query_t query[EDYHT_QUERY_MAX];
+	const char *hdr[EDYHT_HDR_COUNT];  //header values, NULL if not present
+	unsigned int fill;          //bytes in buf
+	unsigned int lineStart;     //start of the incomplete line in buf
+	char buf[EDYHT_REQ_LEN];
+} edyht_req_t;
+
+void edyht_parse_init(edyht_req_t *p);
+
+/* Feed a received segment. *used returns the number of bytes consumed, with
+ * CHARPROC_FINISHED the remaining bytes belong to the next (pipelined)
+ * request. Returns CHARPROC_OK if more data is needed. */
+int edyht_parse(edyht_req_t *p, const char *data, unsigned int len, unsigned int *used);
+
+/* Check a header value list like "gzip, deflate;q=0.5" for a lower case
+ * token with quality > 0 (or a "*" element), list may be NULL */
+int edyht_parse_accepts(const char *list, const char *token);
+
+/* Check an If-None-Match value like "\"abc\", W/\"def\"" for etag (incl.
+ * quotes), "*" matches any, list may be NULL */
+int edyht_parse_etag_match(const char *list, const char *etag);
+
+//No data of a new request received yet
+static inline int edyht_parse_idle(const edyht_req_t *p){
+	return (p->fill == 0) && !p->skip;
+}
+
+#endif // __EDYHT_PARSE_H__
@@ -0,0 +1,112 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht_snap.c
+ * @brief edyht - multi-buffered data published by producer tasks
+ * @copyright BSD 2-Clause License
+ *
+ * The producer only writes pub, back and seq, readers only hold. A reader
+ * reads seq before pub and checks seq again after taking the hold; the
+ * producer sets pub before incrementing seq and never chooses the
+ * published buffer as back buffer. So a held buffer is either still the
+ * published one or was never chosen by the producer since it was
+ * published.
+ *
+ */
+
+#include <string.h>
+
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+#include "edyht_snap.h"
+
+#define SNAP_BARRIER()  __sync_synchronize()
+
+void* edyht_snap_back(edyht_snap_t *s){
+	unsigned int i;
+
+	if(s->back == EDYHT_SNAP_NONE){
+		for(i = 0; i < s->bufs; i++){
+			if((i != s->pub) && (s->hold[i] == 0)){
+				s->back = i;
+				break;
+			}
+		}
+		if(s->back == EDYHT_SNAP_NONE){
+			s->skipped++;
+			return NULL;
+		}
+		SNAP_BARRIER(); //back chosen before it is written
+	}
+	return s->buf[s->back];
+}
+
+void edyht_snap_publish(edyht_snap_t *s){
+	if(s->back == EDYHT_SNAP_NONE) return;
+	SNAP_BARRIER(); //data before pub
+	s->pub = s->back;
+	SNAP_BARRIER();
+	s->seq++;
+	s->back = EDYHT_SNAP_NONE;
+}
+
+unsigned int edyht_snap_hold(edyht_snap_t *s){
+	unsigned int seq, idx;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	for(;;){
+		seq = s->seq;
+		SNAP_BARRIER();
+		idx = s->pub;
+		SYS_ARCH_PROTECT(lev);
+		s->hold[idx]++;
+		SYS_ARCH_UNPROTECT(lev);
+		SNAP_BARRIER();
+		if(s->seq == seq) return idx;
+		//published again meanwhile, idx may be the back buffer now
+		edyht_snap_release(s, idx);
+	}
+}
+
+void edyht_snap_release(edyht_snap_t *s, unsigned int idx){
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	s->hold[idx]--;
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+unsigned int edyht_snap_copy(const edyht_snap_t *s, void *dst, unsigned int offset, unsigned int len){
+	unsigned int seq;
+
+	do{
+		seq = s->seq;
+		SNAP_BARRIER();
+		memcpy(dst, (const char*)s->buf[s->pub] + offset, len);
+		SNAP_BARRIER();
+	}while(s->seq != seq);
+	return seq;
+}
@@ -0,0 +1,50 @@
+#ifndef __EDYHT_SNAP_H__
+#define __EDYHT_SNAP_H__
+
+#include "edyht.h"
+
+#define EDYHT_SNAP_NONE  0xff
+
+/* Data published by a producer task (e.g. a control loop) for handlers,
+ * in 2 or 3 buffers provided by the application. The producer fills the
+ * back buffer and publishes it, readers hold the latest published buffer
+ * while they serialize it. The producer never waits: it only writes
+ * buffers that are neither published nor held. With 3 buffers one can
+ * always be written while readers hold the latest data, with 2 a publish
+ * is skipped while a reader still holds older data. */
+struct edyht_snap {
+	void *buf[3];
+	unsigned int bufs;              //2 or 3
+	unsigned int size;              //bytes per buffer
+	volatile unsigned int seq;      //number of publishes, usable as version of a page
+	volatile unsigned char pub;     //published buffer
+	volatile unsigned char back;    //buffer being written, EDYHT_SNAP_NONE: not chosen yet
+	volatile unsigned char hold[3]; //readers per buffer
+	volatile unsigned int skipped;  //edyht_snap_back calls without free buffer
+};
+
+/* bufs is an array of 2 or 3 buffers, e.g. static int samples[3][1000] */
+#define EDYHT_SNAP_INIT(bufs) \
+	{ { (bufs)[0], (bufs)[1], (sizeof(bufs) > 2 * sizeof((bufs)[0])) ? (bufs)[2] : NULL }, \
+	  sizeof(bufs)/sizeof((bufs)[0]), sizeof((bufs)[0]), 0, 0, EDYHT_SNAP_NONE, { 0, 0, 0 }, 0 }
+
+/* Producer side, one task only, lock-free: back returns the buffer to fill
+ * (the same one until the next publish) or NULL if all are held by
+ * readers, publish makes it the latest data. */
+void* edyht_snap_back(edyht_snap_t *s);
+void edyht_snap_publish(edyht_snap_t *s);
+
+/* Reader side: hold returns the index of the latest published buffer,
+ * which stays unchanged until it is released. Release every hold, also
+ * when a response is aborted (see edyht_provider_t). */
+unsigned int edyht_snap_hold(edyht_snap_t *s);
+void edyht_snap_release(edyht_snap_t *s, unsigned int idx);
+static inline const void* edyht_snap_data(const edyht_snap_t *s, unsigned int idx){
+	return s->buf[idx];
+}
+
+/* Consistent copy of len bytes at offset of the latest data without a
+ * hold (seqlock), for small reads. Returns the seq of the copied data. */
+unsigned int edyht_snap_copy(const edyht_snap_t *s, void *dst, unsigned int offset, unsigned int len);
+
+#endif // __EDYHT_SNAP_H__
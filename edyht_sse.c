@@ -0,0 +1,99 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht_sse.c
+ * @brief edyht - Server-Sent Events with delta updates
+ * @copyright BSD 2-Clause License
+ *
+ * Version stamps per array element: the publisher only stores values and
+ * stamps, the serializer of each subscriber picks the elements stamped
+ * after the last version this subscriber has seen. Subscribers that are
+ * rate limited or slow therefore get the accumulated changes in one event.
+ *
+ */
+
+#include "edyht_sse.h"
+#include "edyht_fmt.h"
+
+#define SSE_BARRIER()  __sync_synchronize()
+
+//stamp in (seen, version], wrap-around safe
+static inline int stampNew(unsigned int stamp, unsigned int seen, unsigned int version){
+	return (stamp - seen - 1) < (version - seen);
+}
+
+void edyht_sse_set(edyht_sse_t *t, unsigned int idx, int val){
+	if((idx >= t->n) || (t->vals[idx] == val)) return;
+	t->vals[idx] = val;
+	t->stamps[idx] = t->version + 1;
+}
+
+void edyht_sse_publish(edyht_sse_t *t){
+	SSE_BARRIER(); //values and stamps before the version
+	t->version = t->version + 1;
+}
+
+#define PAIR_MAX  (2*EDYHT_FMT_MAX + 2)
+
+int edyht_sse_write(edyht_writer_t *w, edyht_sse_t *t, unsigned int *seen, int full){
+	unsigned int version = t->version;
+	unsigned int changed = 0;
+	unsigned int i;
+
+	SSE_BARRIER(); //version before values and stamps
+	if(!full){
+		for(i = 0; i < t->n; i++){
+			if(stampNew(t->stamps[i], *seen, version)) changed++;
+		}
+		if(changed == 0){
+			*seen = version;
+			return 0;
+		}
+		full = (2*changed > t->n); //pairs are larger than the whole array
+	}
+
+	edyht_printf(w, "id: %u\nevent: %s\ndata: [", version, full ? "full" : "delta");
+	if(full){
+		edyht_write_int_array(w, t->vals, t->n, EDYHT_FMT_JSON);
+	}
+	else{
+		int first = 1;
+		for(i = 0; i < t->n; i++){
+			if(!stampNew(t->stamps[i], *seen, version)) continue;
+			char *buf = edyht_write_reserve(w, PAIR_MAX);
+			int len = 0;
+			if(!first) buf[len++] = ',';
+			len += edyht_fmt_uint(&buf[len], i);
+			buf[len++] = ',';
+			len += edyht_fmt_int(&buf[len], t->vals[i]);
+			edyht_write_commit(w, len);
+			first = 0;
+		}
+	}
+	edyht_write_const(w, "]\n\n", 3);
+	*seen = version;
+	return 1;
+}
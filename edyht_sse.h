@@ -0,0 +1,33 @@
+#ifndef __EDYHT_SSE_H__
+#define __EDYHT_SSE_H__
+
+#include "edyht.h"
+
+/* Integer array pushed to subscribers of an event stream route, see
+ * edyht_register_sse. Every entry of stamps holds the version in which the
+ * element last changed, so each subscriber only gets the elements changed
+ * since its previous event. Storage is provided by the application. */
+struct edyht_sse {
+	int *vals;                      //published values, change with edyht_sse_set only
+	unsigned int *stamps;           //one per value, initialize to 0
+	unsigned int n;
+	unsigned int interval;          //min. time (ms) between two events to one subscriber
+	volatile unsigned int version;  //incremented by edyht_sse_publish
+};
+
+#define EDYHT_SSE_INIT(vals, stamps, interval) \
+	{ (vals), (stamps), sizeof(vals)/sizeof((vals)[0]), (interval), 0 }
+
+/* Publisher side, never blocks: set changes the value of element idx,
+ * publish makes all changes since the last publish visible as one event.
+ * Call both from one task only. */
+void edyht_sse_set(edyht_sse_t *t, unsigned int idx, int val);
+void edyht_sse_publish(edyht_sse_t *t);
+
+/* Used by the server: write one event with the elements changed after
+ * version *seen ("event: delta", data: index,value pairs) or all elements
+ * if full is set or most of them changed ("event: full"). Updates *seen,
+ * returns 0 if nothing changed. */
+int edyht_sse_write(edyht_writer_t *w, edyht_sse_t *t, unsigned int *seen, int full);
+
+#endif // __EDYHT_SSE_H__
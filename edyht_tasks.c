@@ -0,0 +1,237 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht_tasks.c
+ * @brief edyht - FreeRTOS task list
+ * @copyright BSD 2-Clause License
+ *
+ * uxTaskGetSystemState replaces vTaskList / vTaskGetRunTimeStats, which
+ * format into a caller buffer of unknown required size. The snapshot is
+ * kept in static arrays and renewed at most once per EDYHT_TASKS_TTL, each
+ * request sorts and filters its own copy.
+ *
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "lwip/opt.h"
+#include "edyht_tasks.h"
+#include "edyht_fmt.h"
+
+typedef struct {
+	char name[configMAX_TASK_NAME_LEN];
+	uint32_t runTime;
+	UBaseType_t num;
+	configSTACK_DEPTH_TYPE stackFree;  //words, high water mark
+	uint8_t state;                     //eTaskState
+	uint8_t prio;
+	uint8_t basePrio;
+} taskEntry_t;
+
+typedef struct {
+	taskEntry_t tasks[EDYHT_TASKS_MAX];
+	unsigned int count;
+	unsigned int total;                //number of tasks, > count if not all fit
+	uint32_t runTime;                  //total run time for the CPU usage
+	TickType_t taken;
+} snapshot_t;
+
+static snapshot_t snap;
+static TaskStatus_t status[EDYHT_TASKS_MAX];
+static uint8_t snapValid;
+static volatile unsigned int snapSeq;  //odd while the snapshot is renewed
+
+#define SNAP_BARRIER()  __sync_synchronize()
+
+static const char * const stateNames[] = { "running", "ready", "blocked", "suspended", "deleted", "invalid" };
+
+//Renew the snapshot with the scheduler suspended, unless another task just did
+static void snapshotRenew(void){
+	TickType_t now;
+
+	vTaskSuspendAll();
+	now = xTaskGetTickCount();
+	if(!snapValid || ((TickType_t)(now - snap.taken) >= pdMS_TO_TICKS(EDYHT_TASKS_TTL))){
+		unsigned int i, n;
+		uint32_t runTime = 0;
+
+		snapSeq++;
+		SNAP_BARRIER();
+		n = uxTaskGetSystemState(status, EDYHT_TASKS_MAX, &runTime);
+		for(i = 0; i < n; i++){
+			taskEntry_t *t = &snap.tasks[i];
+			strncpy(t->name, status[i].pcTaskName, configMAX_TASK_NAME_LEN - 1);
+			t->name[configMAX_TASK_NAME_LEN - 1] = 0;
+			t->runTime = status[i].ulRunTimeCounter;
+			t->num = status[i].xTaskNumber;
+			t->stackFree = status[i].usStackHighWaterMark;
+			t->state = status[i].eCurrentState;
+			t->prio = status[i].uxCurrentPriority;
+			t->basePrio = status[i].uxBasePriority;
+		}
+		snap.count = n;
+		snap.total = uxTaskGetNumberOfTasks();
+		snap.runTime = runTime;
+		snap.taken = now;
+		snapValid = 1;
+		SNAP_BARRIER();
+		snapSeq++;
+	}
+	xTaskResumeAll();
+}
+
+//Copy of the snapshot, renewed if older than EDYHT_TASKS_TTL. A fresh
+//snapshot is copied without suspending the scheduler, the copy is retried
+//if it was renewed meanwhile.
+static void snapshotGet(snapshot_t *s){
+	unsigned int seq;
+	int renewed = 0;
+
+	for(;;){
+		seq = snapSeq;
+		SNAP_BARRIER();
+		if(!(seq & 1) && snapValid &&
+				(renewed || ((TickType_t)(xTaskGetTickCount() - snap.taken) < pdMS_TO_TICKS(EDYHT_TASKS_TTL)))){
+			s->count = snap.count;
+			s->total = snap.total;
+			s->runTime = snap.runTime;
+			s->taken = snap.taken;
+			memcpy(s->tasks, snap.tasks, s->count * sizeof(taskEntry_t));
+			SNAP_BARRIER();
+			if(snapSeq == seq) return;
+			continue;
+		}
+		snapshotRenew();
+		renewed = 1;
+	}
+}
+
+typedef enum { SORT_NUM, SORT_NAME, SORT_STATE, SORT_PRIO, SORT_STACK, SORT_CPU } sortKey_t;
+
+static sortKey_t sortKey(const char *s){
+	if(s == NULL) return SORT_NUM;
+	if(strcmp(s, "name") == 0) return SORT_NAME;
+	if(strcmp(s, "state") == 0) return SORT_STATE;
+	if(strcmp(s, "prio") == 0) return SORT_PRIO;
+	if(strcmp(s, "stack") == 0) return SORT_STACK;
+	if(strcmp(s, "cpu") == 0) return SORT_CPU;
+	return SORT_NUM;
+}
+
+//1 if a comes before b: highest priority / CPU usage and least free stack first
+static int before(const taskEntry_t *a, const taskEntry_t *b, sortKey_t key){
+	switch(key){
+	case SORT_NAME:  return strcmp(a->name, b->name) < 0;
+	case SORT_STATE: return a->state < b->state;
+	case SORT_PRIO:  return a->prio > b->prio;
+	case SORT_STACK: return a->stackFree < b->stackFree;
+	case SORT_CPU:   return a->runTime > b->runTime;
+	default:         return a->num < b->num;
+	}
+}
+
+//Sort by the query, drop filtered tasks, returns number left
+static unsigned int taskSelect(edyht_writer_t *w, snapshot_t *s){
+	sortKey_t key = sortKey(edyht_query_get(w, "sort"));
+	const char *state = edyht_query_get(w, "state");
+	const char *name = edyht_query_get(w, "name");
+	unsigned int i, j, n = 0;
+
+	for(i = 0; i < s->count; i++){
+		taskEntry_t t = s->tasks[i];
+		if((state != NULL) && (strcmp(state, stateNames[(t.state < eInvalid) ? t.state : eInvalid]) != 0)) continue;
+		if((name != NULL) && (strncmp(t.name, name, strlen(name)) != 0)) continue;
+		//insertion sort, few entries
+		for(j = n; (j > 0) && before(&t, &s->tasks[j - 1], key); j--){
+			s->tasks[j] = s->tasks[j - 1];
+		}
+		s->tasks[j] = t;
+		n++;
+	}
+	return n;
+}
+
+//CPU usage in 0.1 %
+static inline unsigned int cpuPermille(const snapshot_t *s, const taskEntry_t *t){
+	if(s->runTime == 0) return 0;
+	return (unsigned int)(((uint64_t)t->runTime * 1000) / s->runTime);
+}
+
+void edyht_tasks_json(edyht_writer_t *w){
+	snapshot_t s;
+	unsigned int i, n;
+	char *buf;
+
+	snapshotGet(&s);
+	n = taskSelect(w, &s);
+	edyht_printf(w, "{\"ticks\":%lu,\"total\":%u,\"tasks\":[", (unsigned long)s.taken, s.total);
+	for(i = 0; i < n; i++){
+		const taskEntry_t *t = &s.tasks[i];
+		edyht_printf(w, "%s{\"num\":%u,\"name\":\"%s\",\"state\":\"%s\",\"prio\":%u,\"base_prio\":%u,\"stack\":%u,\"runtime\":%lu,\"cpu\":",
+				(i > 0) ? "," : "", (unsigned int)t->num, t->name, stateNames[(t->state < eInvalid) ? t->state : eInvalid],
+				t->prio, t->basePrio, (unsigned int)t->stackFree, (unsigned long)t->runTime);
+		buf = edyht_write_reserve(w, EDYHT_FMT_MAX + 1);
+		edyht_write_commit(w, edyht_fmt_fix(buf, cpuPermille(&s, t), 1));
+		edyht_write_const(w, "}", 1);
+	}
+	edyht_write_const(w, "]}", 2);
+}
+
+void edyht_tasks_html(edyht_writer_t *w){
+	snapshot_t s;
+	unsigned int i, n, len;
+	char *buf;
+	time_t now;
+
+	snapshotGet(&s);
+	n = taskSelect(w, &s);
+	edyht_write_const(w, "<table>\n<tr><th>Num</th><th>Name</th><th>State</th><th>Priority</th><th>Stack</th><th>CPU %</th></tr>\n", 102);
+	for(i = 0; i < n; i++){
+		const taskEntry_t *t = &s.tasks[i];
+		edyht_printf(w, "<tr><td>%u</td><td>%s</td><td>%s</td><td>%u</td><td>%u</td><td>",
+				(unsigned int)t->num, t->name, stateNames[(t->state < eInvalid) ? t->state : eInvalid],
+				t->prio, (unsigned int)t->stackFree);
+		buf = edyht_write_reserve(w, EDYHT_FMT_MAX);
+		edyht_write_commit(w, edyht_fmt_fix(buf, cpuPermille(&s, t), 1));
+		edyht_write_const(w, "</td></tr>\n", 11);
+	}
+	edyht_write_const(w, "</table>\n", 9);
+	if(s.total > s.count){
+		edyht_printf(w, "<p>%u tasks, more than EDYHT_TASKS_MAX</p>\n", s.total);
+	}
+
+	time(&now);
+	buf = edyht_write_reserve(w, 16 + 26 + 4);
+	memcpy(buf, "<p>System Time: ", 16);
+	ctime_r(&now, buf + 16);
+	len = strlen(buf + 16);
+	if((len > 0) && (buf[16 + len - 1] == '\n')) len--;  //ctime_r ends with a newline
+	memcpy(buf + 16 + len, "</p>\n", 5);
+	edyht_write_commit(w, 16 + len + 5);
+}
@@ -0,0 +1,14 @@
+#ifndef __EDYHT_TASKS_H__
+#define __EDYHT_TASKS_H__
+
+#include "edyht.h"
+
+/* Page handlers for the FreeRTOS task list incl. CPU usage (with
+ * configGENERATE_RUN_TIME_STATS), from a snapshot shared by all requests
+ * within EDYHT_TASKS_TTL. Needs configUSE_TRACE_FACILITY.
+ * Query: sort=num|name|state|prio|stack|cpu, state=running|ready|blocked|
+ * suspended and name=<prefix> to filter. */
+void edyht_tasks_json(edyht_writer_t *w);
+void edyht_tasks_html(edyht_writer_t *w); //table for the body of tasks.htm
+
+#endif // __EDYHT_TASKS_H__
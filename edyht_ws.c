@@ -0,0 +1,300 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file edyht_ws.c
+ * @brief edyht - WebSocket (RFC 6455) handshake and framing
+ * @copyright BSD 2-Clause License
+ *
+ * SHA-1 and base64 for the opening handshake, an incremental decoder for
+ * masked client frames and the header of unmasked server frames. Sending
+ * and the connection state are part of edyht.c.
+ *
+ */
+
+#include <string.h>
+
+#include "edyht_ws.h"
+
+static const char wsGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+typedef struct {
+	uint32_t h[5];
+	uint32_t len;               //message length in bytes
+	uint8_t block[64];
+} sha1_t;
+
+static inline uint32_t rol(uint32_t x, unsigned int n){
+	return (x << n) | (x >> (32 - n));
+}
+
+static void sha1Block(sha1_t *s){
+	uint32_t w[80];
+	uint32_t a, b, c, d, e, f, k, t;
+	int i;
+
+	for(i = 0; i < 16; i++){
+		w[i] = ((uint32_t)s->block[4*i] << 24) | ((uint32_t)s->block[4*i+1] << 16)
+				| ((uint32_t)s->block[4*i+2] << 8) | s->block[4*i+3];
+	}
+	for(i = 16; i < 80; i++){
+		w[i] = rol(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+	}
+
+	a = s->h[0]; b = s->h[1]; c = s->h[2]; d = s->h[3]; e = s->h[4];
+	for(i = 0; i < 80; i++){
+		if(i < 20){
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		}
+		else if(i < 40){
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		}
+		else if(i < 60){
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		}
+		else{
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+		t = rol(a, 5) + f + e + k + w[i];
+		e = d; d = c; c = rol(b, 30); b = a; a = t;
+	}
+	s->h[0] += a; s->h[1] += b; s->h[2] += c; s->h[3] += d; s->h[4] += e;
+}
+
+static void sha1Init(sha1_t *s){
+	s->h[0] = 0x67452301;
+	s->h[1] = 0xefcdab89;
+	s->h[2] = 0x98badcfe;
+	s->h[3] = 0x10325476;
+	s->h[4] = 0xc3d2e1f0;
+	s->len = 0;
+}
+
+static void sha1Update(sha1_t *s, const void *data, unsigned int len){
+	const uint8_t *src = data;
+	while(len--){
+		s->block[s->len++ & 63] = *src++;
+		if((s->len & 63) == 0) sha1Block(s);
+	}
+}
+
+static void sha1Final(sha1_t *s, uint8_t *digest){
+	uint32_t bits = s->len * 8;
+	unsigned int i = s->len & 63;
+
+	s->block[i++] = 0x80;
+	if(i > 56){
+		memset(&s->block[i], 0, 64 - i);
+		sha1Block(s);
+		i = 0;
+	}
+	memset(&s->block[i], 0, 60 - i);
+	s->block[60] = bits >> 24;
+	s->block[61] = bits >> 16;
+	s->block[62] = bits >> 8;
+	s->block[63] = bits;
+	sha1Block(s);
+
+	for(i = 0; i < 20; i++){
+		digest[i] = s->h[i/4] >> (24 - 8*(i & 3));
+	}
+}
+
+static void base64(const uint8_t *src, unsigned int len, char *out){
+	static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	unsigned int i;
+
+	for(i = 0; i + 2 < len; i += 3){
+		uint32_t v = ((uint32_t)src[i] << 16) | ((uint32_t)src[i+1] << 8) | src[i+2];
+		*out++ = b64[(v >> 18) & 63];
+		*out++ = b64[(v >> 12) & 63];
+		*out++ = b64[(v >> 6) & 63];
+		*out++ = b64[v & 63];
+	}
+	if(i < len){
+		uint32_t v = (uint32_t)src[i] << 16;
+		if(i + 1 < len) v |= (uint32_t)src[i+1] << 8;
+		*out++ = b64[(v >> 18) & 63];
+		*out++ = b64[(v >> 12) & 63];
+		*out++ = (i + 1 < len) ? b64[(v >> 6) & 63] : '=';
+		*out++ = '=';
+	}
+	*out = '\0';
+}
+
+void edyht_ws_accept(const char *key, char *out){
+	sha1_t s;
+	uint8_t digest[20];
+
+	sha1Init(&s);
+	sha1Update(&s, key, strlen(key));
+	sha1Update(&s, wsGuid, sizeof(wsGuid) - 1);
+	sha1Final(&s, digest);
+	base64(digest, sizeof(digest), out);
+}
+
+unsigned int edyht_ws_header(uint8_t *hdr, uint8_t opcode, uint32_t len){
+	hdr[0] = 0x80 | opcode;
+	if(len < 126){
+		hdr[1] = len;
+		return 2;
+	}
+	if(len <= 0xffff){
+		hdr[1] = 126;
+		hdr[2] = len >> 8;
+		hdr[3] = len;
+		return 4;
+	}
+	hdr[1] = 127;
+	memset(&hdr[2], 0, 4);
+	hdr[6] = len >> 24;
+	hdr[7] = len >> 16;
+	hdr[8] = len >> 8;
+	hdr[9] = len;
+	return 10;
+}
+
+void edyht_ws_rx_init(edyht_ws_rx_t *rx){
+	rx->hdrLen = 0;
+	rx->hdrNeed = 2;
+	rx->msgOpcode = 0;
+	rx->msgLen = 0;
+}
+
+//Frame header complete, returns EDYHT_WS_RX_FRAME for an empty frame
+static int headerProcess(edyht_ws_rx_t *rx){
+	const uint8_t *h = rx->hdr;
+	unsigned int i;
+
+	rx->fin = h[0] & 0x80;
+	rx->opcode = h[0] & 0x0f;
+	rx->pos = 0;
+	if(h[0] & 0x70) return EDYHT_WS_RX_ERR_PROTO;       //no extensions negotiated
+
+	if((h[1] & 0x7f) == 126){
+		rx->len = ((uint32_t)h[2] << 8) | h[3];
+	}
+	else if((h[1] & 0x7f) == 127){
+		if(h[2] | h[3] | h[4] | h[5]) return EDYHT_WS_RX_ERR_SIZE;
+		rx->len = ((uint32_t)h[6] << 24) | ((uint32_t)h[7] << 16) | ((uint32_t)h[8] << 8) | h[9];
+	}
+	else{
+		rx->len = h[1] & 0x7f;
+	}
+
+	if(rx->opcode & 0x08){
+		//control frame
+		if(!rx->fin || (rx->len > EDYHT_WS_CTRL_MAX)) return EDYHT_WS_RX_ERR_PROTO;
+		if((rx->opcode != EDYHT_WS_OP_CLOSE) && (rx->opcode != EDYHT_WS_OP_PING)
+				&& (rx->opcode != EDYHT_WS_OP_PONG)) return EDYHT_WS_RX_ERR_PROTO;
+	}
+	else if(rx->opcode == EDYHT_WS_OP_CONT){
+		if(rx->msgOpcode == 0) return EDYHT_WS_RX_ERR_PROTO;
+	}
+	else if((rx->opcode == EDYHT_WS_OP_TEXT) || (rx->opcode == EDYHT_WS_OP_BINARY)){
+		if(rx->msgOpcode != 0) return EDYHT_WS_RX_ERR_PROTO;  //previous message not finished
+		rx->msgOpcode = rx->opcode;
+	}
+	else{
+		return EDYHT_WS_RX_ERR_PROTO;
+	}
+	if(!(rx->opcode & 0x08) && (rx->len > EDYHT_WS_MSG_LEN - rx->msgLen)) return EDYHT_WS_RX_ERR_SIZE;
+
+	i = rx->hdrNeed - 4;
+	memmove(rx->hdr, &rx->hdr[i], 4); //mask key, may overlap
+	return EDYHT_WS_RX_MORE;
+}
+
+//Payload of the current frame complete
+static int frameDone(edyht_ws_rx_t *rx, edyht_ws_frame_t *frame){
+	rx->hdrLen = 0;
+	rx->hdrNeed = 2;
+
+	if(rx->opcode & 0x08){
+		rx->ctrl[rx->len] = '\0';
+		frame->opcode = rx->opcode;
+		frame->data = rx->ctrl;
+		frame->len = rx->len;
+		return EDYHT_WS_RX_FRAME;
+	}
+	rx->msgLen += rx->len;
+	if(!rx->fin) return EDYHT_WS_RX_MORE;
+
+	rx->msg[rx->msgLen] = '\0';
+	frame->opcode = rx->msgOpcode;
+	frame->data = rx->msg;
+	frame->len = rx->msgLen;
+	rx->msgOpcode = 0;
+	rx->msgLen = 0;
+	return EDYHT_WS_RX_FRAME;
+}
+
+int edyht_ws_rx(edyht_ws_rx_t *rx, const uint8_t *data, unsigned int len, unsigned int *used, edyht_ws_frame_t *frame){
+	unsigned int pos = 0;
+	int ret;
+
+	while(pos < len){
+		if(rx->hdrLen < rx->hdrNeed){
+			rx->hdr[rx->hdrLen++] = data[pos++];
+			if(rx->hdrLen == 2){
+				if(!(rx->hdr[1] & 0x80)){
+					*used = pos;
+					return EDYHT_WS_RX_ERR_PROTO;  //client frames must be masked
+				}
+				rx->hdrNeed = 2 + 4 + (((rx->hdr[1] & 0x7f) == 126) ? 2 : ((rx->hdr[1] & 0x7f) == 127) ? 8 : 0);
+			}
+			if(rx->hdrLen < rx->hdrNeed) continue;
+
+			ret = headerProcess(rx);
+			if((ret == EDYHT_WS_RX_MORE) && (rx->len == 0)) ret = frameDone(rx, frame);
+			if(ret != EDYHT_WS_RX_MORE){
+				*used = pos;
+				return ret;
+			}
+		}
+		else{
+			uint8_t *dst = (rx->opcode & 0x08) ? rx->ctrl : &rx->msg[rx->msgLen];
+			unsigned int n = len - pos;
+			if(n > rx->len - rx->pos) n = rx->len - rx->pos;
+			while(n--){
+				dst[rx->pos] = data[pos++] ^ rx->hdr[rx->pos & 3];
+				rx->pos++;
+			}
+			if(rx->pos == rx->len){
+				ret = frameDone(rx, frame);
+				if(ret != EDYHT_WS_RX_MORE){
+					*used = pos;
+					return ret;
+				}
+			}
+		}
+	}
+	*used = pos;
+	return EDYHT_WS_RX_MORE;
+}
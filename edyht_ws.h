@@ -0,0 +1,58 @@
+#ifndef __EDYHT_WS_H__
+#define __EDYHT_WS_H__
+
+#include <stdint.h>
+#include "edyht.h"
+
+#define EDYHT_WS_OP_CONT    0x0
+#define EDYHT_WS_OP_TEXT    0x1
+#define EDYHT_WS_OP_BINARY  0x2
+#define EDYHT_WS_OP_CLOSE   0x8
+#define EDYHT_WS_OP_PING    0x9
+#define EDYHT_WS_OP_PONG    0xa
+
+#define EDYHT_WS_CTRL_MAX   125   //max. payload of control frames
+#define EDYHT_WS_HDR_MAX    10    //header of an unmasked server frame
+#define EDYHT_WS_ACCEPT_LEN 28    //base64 of a SHA-1 hash
+
+#define EDYHT_WS_RX_MORE       0  //more data needed
+#define EDYHT_WS_RX_FRAME      1  //complete message or control frame
+#define EDYHT_WS_RX_ERR_PROTO -1  //close with status 1002
+#define EDYHT_WS_RX_ERR_SIZE  -2  //message larger than EDYHT_WS_MSG_LEN, close with 1009
+
+typedef struct {
+	uint8_t opcode;             //TEXT, BINARY or a control frame
+	const uint8_t *data;        //unmasked payload, text is "0" terminated
+	unsigned int len;
+} edyht_ws_frame_t;
+
+/* Frame decoder, one per WebSocket connection. Fragmented messages are
+ * collected in msg, control frames in between use ctrl. */
+typedef struct {
+	uint8_t hdr[14];
+	uint8_t hdrLen;
+	uint8_t hdrNeed;            //length of the current frame header
+	uint8_t opcode;             //current frame
+	uint8_t fin;
+	uint32_t len;               //payload length of the current frame
+	uint32_t pos;               //payload bytes received
+	uint8_t msgOpcode;          //first frame of the message being collected, 0: none
+	unsigned int msgLen;
+	uint8_t msg[EDYHT_WS_MSG_LEN + 1];
+	uint8_t ctrl[EDYHT_WS_CTRL_MAX + 1];
+} edyht_ws_rx_t;
+
+/* Sec-WebSocket-Accept for a Sec-WebSocket-Key, out gets
+ * EDYHT_WS_ACCEPT_LEN chars + "0" */
+void edyht_ws_accept(const char *key, char *out);
+
+/* Header of an unmasked frame with FIN set, returns its length */
+unsigned int edyht_ws_header(uint8_t *hdr, uint8_t opcode, uint32_t len);
+
+void edyht_ws_rx_init(edyht_ws_rx_t *rx);
+
+/* Feed received data. *used returns the number of bytes consumed, with
+ * EDYHT_WS_RX_FRAME the frame is valid until the next call. */
+int edyht_ws_rx(edyht_ws_rx_t *rx, const uint8_t *data, unsigned int len, unsigned int *used, edyht_ws_frame_t *frame);
+
+#endif // __EDYHT_WS_H__
@@ -0,0 +1,83 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file host_main.c
+ * @brief edyht - host build running the server as a Linux process
+ * @copyright BSD 2-Clause License
+ *
+ * Runs the netconn backend with the built-in pages on a host port for
+ * functional checks and load tests (bench/bench_load.c). The event stream
+ * /live publishes the uptime (s) and a counter once per second, check it
+ * with "bench_load -p 8080 -s live". lwIP and FreeRTOS
+ * are replaced by host_port.c, so timings show the cost of edyht itself
+ * plus the host TCP stack, not those of a target.
+ *
+ * Build and run from the repository root:
+ *   ./mkhtdocs.sh
+ *   gcc -O2 -pthread -DEDYHT_PORT=8080 -DEDYHT_WORKERS=8 -Ihost/include -I. \
+ *       host/host_main.c host/host_port.c edyht*.c -lm -o edyht_host
+ *   ./edyht_host
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "edyht.h"
+#include "edyht_sse.h"
+#include "lwip/sys.h"
+
+static int liveVals[2];
+static unsigned int liveStamps[2];
+static edyht_sse_t live = EDYHT_SSE_INIT(liveVals, liveStamps, 100);
+
+//Demo publisher of /live
+static void* livePublish(void *arg){
+	int n = 0;
+
+	(void)arg;
+	for(;;){
+		sleep(1);
+		edyht_sse_set(&live, 0, sys_now() / 1000);
+		edyht_sse_set(&live, 1, ++n);
+		edyht_sse_publish(&live);
+	}
+	return NULL;
+}
+
+int main(void){
+	pthread_t publisher;
+
+	//routes are registered before the workers start
+	edyht_register_sse("live", &live);
+	edyht_init();
+	pthread_create(&publisher, NULL, livePublish, NULL);
+	printf("edyht listening on port %d\n", EDYHT_PORT);
+	fflush(stdout);
+	for(;;) pause();
+	return 0;
+}
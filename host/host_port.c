@@ -0,0 +1,404 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file host_port.c
+ * @brief edyht - host port: netconn, sys and FreeRTOS API on POSIX
+ * @copyright BSD 2-Clause License
+ *
+ * Just enough of lwIP and FreeRTOS to run the netconn backend of edyht as
+ * a Linux process: netconns are blocking TCP sockets, tasks are pthreads,
+ * queues use a mutex and a condition variable. The run time of a task is
+ * the CPU time of its thread. See host_main.c.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#undef TCP_MSS //lwIP option of the same name
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "lwip/sys.h"
+#include "lwip/api.h"
+
+#define HOST_TASKS_MAX  32
+#define LISTEN_BACKLOG  16
+
+/*
+ * Time and tasks
+ */
+
+u32_t sys_now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000);
+}
+
+void sys_msleep(u32_t ms){
+	struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+	while(nanosleep(&ts, &ts) != 0 && errno == EINTR);
+}
+
+typedef struct {
+	pthread_t thread;
+	char name[configMAX_TASK_NAME_LEN];
+	UBaseType_t prio;
+	TaskFunction_t fn;
+	void *arg;
+} hostTask_t;
+
+static hostTask_t tasks[HOST_TASKS_MAX];
+static unsigned int taskCount;
+static pthread_mutex_t taskMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void* taskEntry(void *arg){
+	hostTask_t *t = arg;
+	t->fn(t->arg);
+	return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, configSTACK_DEPTH_TYPE stack, void *arg,
+		UBaseType_t prio, TaskHandle_t *handle){
+	hostTask_t *t;
+
+	LWIP_UNUSED_ARG(stack); //host default stack size
+	pthread_mutex_lock(&taskMutex);
+	if(taskCount == HOST_TASKS_MAX){
+		pthread_mutex_unlock(&taskMutex);
+		return pdFAIL;
+	}
+	t = &tasks[taskCount];
+	strncpy(t->name, name, configMAX_TASK_NAME_LEN - 1);
+	t->prio = prio;
+	t->fn = fn;
+	t->arg = arg;
+	if(pthread_create(&t->thread, NULL, taskEntry, t) != 0){
+		pthread_mutex_unlock(&taskMutex);
+		return pdFAIL;
+	}
+	pthread_detach(t->thread);
+	taskCount++;
+	pthread_mutex_unlock(&taskMutex);
+	if(handle != NULL) *handle = t;
+	return pdPASS;
+}
+
+void *sys_thread_new(const char *name, lwip_thread_fn thread, void *arg, int stacksize, int prio){
+	TaskHandle_t handle = NULL;
+	xTaskCreate(thread, name, stacksize, arg, prio, &handle);
+	return handle;
+}
+
+void vTaskDelay(TickType_t ticks){
+	sys_msleep(ticks);
+}
+
+TickType_t xTaskGetTickCount(void){
+	return sys_now();
+}
+
+//Only used around uxTaskGetSystemState, which locks itself
+void vTaskSuspendAll(void){
+}
+
+BaseType_t xTaskResumeAll(void){
+	return pdFALSE;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void){
+	return taskCount;
+}
+
+static uint32_t cpuTimeUs(clockid_t clock){
+	struct timespec ts;
+	if(clock_gettime(clock, &ts) != 0) return 0;
+	return (uint32_t)(ts.tv_sec * 1000000u + ts.tv_nsec / 1000);
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t n, uint32_t *totalRunTime){
+	UBaseType_t i;
+
+	pthread_mutex_lock(&taskMutex);
+	for(i = 0; (i < taskCount) && (i < n); i++){
+		hostTask_t *t = &tasks[i];
+		clockid_t clock;
+
+		memset(&status[i], 0, sizeof(status[i]));
+		status[i].xHandle = t;
+		status[i].pcTaskName = t->name;
+		status[i].xTaskNumber = i + 1;
+		status[i].eCurrentState = eBlocked;
+		status[i].uxCurrentPriority = t->prio;
+		status[i].uxBasePriority = t->prio;
+		if(pthread_getcpuclockid(t->thread, &clock) == 0) status[i].ulRunTimeCounter = cpuTimeUs(clock);
+	}
+	pthread_mutex_unlock(&taskMutex);
+	if(totalRunTime != NULL) *totalRunTime = cpuTimeUs(CLOCK_PROCESS_CPUTIME_ID);
+	return i;
+}
+
+/*
+ * Mutexes, critical sections, queues
+ */
+
+err_t sys_mutex_new(sys_mutex_t *mutex){
+	return (pthread_mutex_init(mutex, NULL) == 0) ? ERR_OK : ERR_MEM;
+}
+
+void sys_mutex_lock(sys_mutex_t *mutex){
+	pthread_mutex_lock(mutex);
+}
+
+void sys_mutex_unlock(sys_mutex_t *mutex){
+	pthread_mutex_unlock(mutex);
+}
+
+static pthread_mutex_t protectMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+sys_prot_t sys_arch_protect(void){
+	pthread_mutex_lock(&protectMutex);
+	return 0;
+}
+
+void sys_arch_unprotect(sys_prot_t pval){
+	LWIP_UNUSED_ARG(pval);
+	pthread_mutex_unlock(&protectMutex);
+}
+
+struct hostQueue {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	UBaseType_t len, itemSize;
+	UBaseType_t head, count;
+	unsigned char items[];
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize){
+	QueueHandle_t q = calloc(1, sizeof(*q) + len * itemSize);
+	if(q == NULL) return NULL;
+	pthread_mutex_init(&q->mutex, NULL);
+	pthread_cond_init(&q->cond, NULL);
+	q->len = len;
+	q->itemSize = itemSize;
+	return q;
+}
+
+//Wait until cond is true, wait in ticks (ms), returns 0 on timeout
+static int queueWait(QueueHandle_t q, int full, TickType_t wait){
+	struct timespec until;
+
+	if(wait != portMAX_DELAY){
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_sec += wait / 1000;
+		until.tv_nsec += (long)(wait % 1000) * 1000000;
+		if(until.tv_nsec >= 1000000000){
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000;
+		}
+	}
+	while(full ? (q->count == q->len) : (q->count == 0)){
+		if(wait == portMAX_DELAY) pthread_cond_wait(&q->cond, &q->mutex);
+		else if(pthread_cond_timedwait(&q->cond, &q->mutex, &until) == ETIMEDOUT) return 0;
+	}
+	return 1;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait){
+	pthread_mutex_lock(&q->mutex);
+	if(!queueWait(q, 1, wait)){
+		pthread_mutex_unlock(&q->mutex);
+		return pdFALSE;
+	}
+	memcpy(&q->items[((q->head + q->count) % q->len) * q->itemSize], item, q->itemSize);
+	q->count++;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+	return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait){
+	pthread_mutex_lock(&q->mutex);
+	if(!queueWait(q, 0, wait)){
+		pthread_mutex_unlock(&q->mutex);
+		return pdFALSE;
+	}
+	memcpy(item, &q->items[q->head * q->itemSize], q->itemSize);
+	q->head = (q->head + 1) % q->len;
+	q->count--;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+	return pdTRUE;
+}
+
+/*
+ * netconn on sockets
+ */
+
+static struct netconn* connAlloc(int fd){
+	struct netconn *conn = calloc(1, sizeof(*conn));
+	if(conn == NULL) return NULL;
+	conn->sock.fd = fd;
+	conn->pcb.tcp = &conn->sock;
+	return conn;
+}
+
+struct netconn *netconn_new(enum netconn_type type){
+	int fd;
+	struct netconn *conn;
+
+	if(type != NETCONN_TCP) return NULL;
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0) return NULL;
+	conn = connAlloc(fd);
+	if(conn == NULL) close(fd);
+	return conn;
+}
+
+err_t netconn_bind(struct netconn *conn, const void *addr, u16_t port){
+	struct sockaddr_in sa;
+	int on = 1;
+
+	LWIP_UNUSED_ARG(addr); //any
+	setsockopt(conn->sock.fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_ANY);
+	sa.sin_port = htons(port);
+	return (bind(conn->sock.fd, (struct sockaddr*)&sa, sizeof(sa)) == 0) ? ERR_OK : ERR_USE;
+}
+
+err_t netconn_listen(struct netconn *conn){
+	return (listen(conn->sock.fd, LISTEN_BACKLOG) == 0) ? ERR_OK : ERR_VAL;
+}
+
+err_t netconn_accept(struct netconn *conn, struct netconn **newconn){
+	int fd;
+
+	do{
+		fd = accept(conn->sock.fd, NULL, NULL);
+	}while((fd < 0) && (errno == EINTR));
+	if(fd < 0) return ERR_ABRT;
+	*newconn = connAlloc(fd);
+	if(*newconn == NULL){
+		close(fd);
+		return ERR_MEM;
+	}
+	return ERR_OK;
+}
+
+err_t netconn_recv(struct netconn *conn, struct netbuf **buf){
+	struct pollfd pfd = { conn->sock.fd, POLLIN, 0 };
+	struct netbuf *nb;
+	ssize_t n;
+	int ret;
+
+	*buf = NULL;
+	do{
+		ret = poll(&pfd, 1, (conn->recvTimeout > 0) ? conn->recvTimeout : -1);
+	}while((ret < 0) && (errno == EINTR));
+	if(ret == 0) return ERR_TIMEOUT;
+	if(ret < 0) return ERR_CONN;
+
+	nb = malloc(sizeof(*nb));
+	if(nb == NULL) return ERR_MEM;
+	do{
+		n = recv(conn->sock.fd, nb->data, sizeof(nb->data), 0);
+	}while((n < 0) && (errno == EINTR));
+	if(n <= 0){
+		free(nb);
+		return (n == 0) ? ERR_CLSD : ERR_RST;
+	}
+	nb->len = n;
+	*buf = nb;
+	return ERR_OK;
+}
+
+err_t netconn_write_partly(struct netconn *conn, const void *data, size_t size, u8_t flags, size_t *written){
+	const char *src = data;
+	size_t done = 0;
+
+	//NETCONN_MORE: more data follows, like the missing PSH flag
+	int sendFlags = MSG_NOSIGNAL | ((flags & NETCONN_MORE) ? MSG_MORE : 0);
+	while(done < size){
+		ssize_t n = send(conn->sock.fd, src + done, size - done, sendFlags);
+		if(n < 0){
+			if(errno == EINTR) continue;
+			if(written != NULL) *written = done;
+			if((errno == EAGAIN) || (errno == EWOULDBLOCK)) return ERR_WOULDBLOCK; //send timeout
+			return (errno == EPIPE) ? ERR_CLSD : ERR_RST;
+		}
+		done += n;
+	}
+	if(written != NULL) *written = done;
+	return ERR_OK;
+}
+
+void netconn_set_sendtimeout(struct netconn *conn, int ms){
+	struct timeval tv = { ms / 1000, (ms % 1000) * 1000 };
+	setsockopt(conn->sock.fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+err_t netconn_close(struct netconn *conn){
+	if(conn->sock.fd >= 0){
+		shutdown(conn->sock.fd, SHUT_WR);
+		close(conn->sock.fd);
+		conn->sock.fd = -1;
+	}
+	return ERR_OK;
+}
+
+err_t netconn_delete(struct netconn *conn){
+	if(conn == NULL) return ERR_OK;
+	netconn_close(conn);
+	free(conn);
+	return ERR_OK;
+}
+
+err_t netbuf_data(struct netbuf *buf, void **data, u16_t *len){
+	*data = buf->data;
+	*len = buf->len;
+	return ERR_OK;
+}
+
+void netbuf_delete(struct netbuf *buf){
+	free(buf);
+}
+
+void tcp_nagle_disable(struct tcp_pcb *pcb){
+	int on = 1;
+	setsockopt(pcb->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
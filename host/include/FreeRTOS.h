@@ -0,0 +1,28 @@
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+/* Host port: the parts of the FreeRTOS API used by edyht, on pthreads.
+ * Ticks are milliseconds. */
+
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint16_t configSTACK_DEPTH_TYPE;
+
+#define pdFALSE  0
+#define pdTRUE   1
+#define pdPASS   pdTRUE
+#define pdFAIL   pdFALSE
+
+#define portMAX_DELAY         ((TickType_t)0xffffffffu)
+#define configTICK_RATE_HZ    1000
+#define pdMS_TO_TICKS(ms)     ((TickType_t)(ms))
+#define tskIDLE_PRIORITY      0
+
+#define configMAX_TASK_NAME_LEN         16
+#define configUSE_TRACE_FACILITY        1
+#define configGENERATE_RUN_TIME_STATS   1
+
+#endif // __HOST_FREERTOS_H__
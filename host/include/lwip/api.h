@@ -0,0 +1,57 @@
+#ifndef __HOST_LWIP_API_H__
+#define __HOST_LWIP_API_H__
+
+/* Host port: netconn API on POSIX TCP sockets, blocking, one netbuf per
+ * recv() call. */
+
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+#include "lwip/tcp.h"
+
+enum netconn_type {
+	NETCONN_TCP = 0x10
+};
+
+#define NETCONN_NOFLAG     0x00
+#define NETCONN_NOCOPY     0x00
+#define NETCONN_COPY       0x01
+#define NETCONN_MORE       0x02
+#define NETCONN_DONTBLOCK  0x04
+
+struct netconn {
+	union {
+		struct tcp_pcb *tcp;
+	} pcb;
+	struct tcp_pcb sock;
+	int recvTimeout;        //ms, 0: none
+};
+
+struct netbuf {
+	u16_t len;
+	char data[TCP_MSS];
+};
+
+struct netconn *netconn_new(enum netconn_type type);
+err_t netconn_bind(struct netconn *conn, const void *addr, u16_t port);
+err_t netconn_listen(struct netconn *conn);
+err_t netconn_accept(struct netconn *conn, struct netconn **newconn);
+err_t netconn_recv(struct netconn *conn, struct netbuf **buf);
+err_t netconn_write_partly(struct netconn *conn, const void *data, size_t size, u8_t flags, size_t *written);
+#define netconn_write(conn, data, size, flags)  netconn_write_partly(conn, data, size, flags, NULL)
+err_t netconn_close(struct netconn *conn);
+err_t netconn_delete(struct netconn *conn);
+#define netconn_set_recvtimeout(conn, ms)  ((conn)->recvTimeout = (ms))
+void netconn_set_sendtimeout(struct netconn *conn, int ms);
+static inline err_t netconn_err(struct netconn *conn){
+	LWIP_UNUSED_ARG(conn);
+	return ERR_OK;
+}
+
+err_t netbuf_data(struct netbuf *buf, void **data, u16_t *len);
+static inline s8_t netbuf_next(struct netbuf *buf){
+	LWIP_UNUSED_ARG(buf);
+	return -1; //always a single part
+}
+void netbuf_delete(struct netbuf *buf);
+
+#endif // __HOST_LWIP_API_H__
@@ -0,0 +1,26 @@
+#ifndef __HOST_LWIP_ARCH_H__
+#define __HOST_LWIP_ARCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t  u8_t;
+typedef int8_t   s8_t;
+typedef uint16_t u16_t;
+typedef int16_t  s16_t;
+typedef uint32_t u32_t;
+typedef int32_t  s32_t;
+
+#ifndef LITTLE_ENDIAN
+#define LITTLE_ENDIAN 1234
+#endif
+#ifndef BIG_ENDIAN
+#define BIG_ENDIAN 4321
+#endif
+#ifndef BYTE_ORDER
+#define BYTE_ORDER LITTLE_ENDIAN
+#endif
+
+#define LWIP_UNUSED_ARG(x) (void)(x)
+
+#endif // __HOST_LWIP_ARCH_H__
@@ -0,0 +1,7 @@
+#ifndef __HOST_LWIP_STATS_H__
+#define __HOST_LWIP_STATS_H__
+
+/* Host port: no lwIP statistics (LWIP_STATS 0) */
+#include "lwip/opt.h"
+
+#endif // __HOST_LWIP_STATS_H__
@@ -0,0 +1,34 @@
+#ifndef __HOST_LWIP_SYS_H__
+#define __HOST_LWIP_SYS_H__
+
+#include <pthread.h>
+
+#include "lwip/opt.h"
+
+typedef void (*lwip_thread_fn)(void *arg);
+typedef pthread_mutex_t sys_mutex_t;
+typedef int sys_prot_t;
+
+void *sys_thread_new(const char *name, lwip_thread_fn thread, void *arg, int stacksize, int prio);
+u32_t sys_now(void);
+void sys_msleep(u32_t ms);
+
+err_t sys_mutex_new(sys_mutex_t *mutex);
+void sys_mutex_lock(sys_mutex_t *mutex);
+void sys_mutex_unlock(sys_mutex_t *mutex);
+
+/* Critical sections: one recursive process wide mutex */
+sys_prot_t sys_arch_protect(void);
+void sys_arch_unprotect(sys_prot_t pval);
+
+#define SYS_ARCH_DECL_PROTECT(lev)  sys_prot_t lev
+#define SYS_ARCH_PROTECT(lev)       lev = sys_arch_protect()
+#define SYS_ARCH_UNPROTECT(lev)     sys_arch_unprotect(lev)
+#define SYS_ARCH_INC(var, val) do { \
+		SYS_ARCH_DECL_PROTECT(old_level); \
+		SYS_ARCH_PROTECT(old_level); \
+		var += val; \
+		SYS_ARCH_UNPROTECT(old_level); \
+	} while(0)
+
+#endif // __HOST_LWIP_SYS_H__
@@ -0,0 +1,13 @@
+#ifndef __HOST_LWIP_TCP_H__
+#define __HOST_LWIP_TCP_H__
+
+#include "lwip/opt.h"
+
+/* Host port: a netconn's pcb is its socket */
+struct tcp_pcb {
+	int fd;
+};
+
+void tcp_nagle_disable(struct tcp_pcb *pcb);
+
+#endif // __HOST_LWIP_TCP_H__
@@ -0,0 +1,10 @@
+#ifndef __HOST_LWIP_TCPIP_H__
+#define __HOST_LWIP_TCPIP_H__
+
+#include "lwip/opt.h"
+
+/* No tcpip thread on the host, sockets are thread safe */
+#define LOCK_TCPIP_CORE()
+#define UNLOCK_TCPIP_CORE()
+
+#endif // __HOST_LWIP_TCPIP_H__
@@ -0,0 +1,27 @@
+#!/bin/sh
+#
+# mkhtdocs.sh - generate edyht_assets.inc (asset table included by edyht.c)
+#
+# Builds the host tool tools/mkassets and runs it on htdocs/. Every file is
+# minified and emitted as one contiguous const array; served files already
+# hold the complete HTTP response (status line, headers incl. Content-Length
+# and body), so the server can hand them to lwIP with a single zero-copy
+# write. Files in htdocs/parts/ are plain body data for dynamic pages,
+# htdocs/errNNN.* are the error responses. Files in htdocs/tpl/ are
+# templates with {{name}} placeholders, split into static segments and slot
+# IDs. Served files also get a gzip copy, sent to clients accepting it. See
+# tools/mkassets.c.
+#
+# Usage: ./mkhtdocs.sh   (run from the repository root, needs a host C
+#                         compiler and zlib; CC selects the compiler,
+#                         RETRY_AFTER the Retry-After seconds of err503.txt)
+#
+
+CC=${CC:-cc}
+RETRY_AFTER=${RETRY_AFTER:-2}
+
+set -e
+if [ ! -x tools/mkassets ] || [ tools/mkassets.c -nt tools/mkassets ]; then
+	$CC -O2 -o tools/mkassets tools/mkassets.c -lz
+fi
+tools/mkassets -z -r $RETRY_AFTER htdocs edyht_assets.inc
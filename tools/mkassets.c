@@ -0,0 +1,672 @@
+/*
+  Copyright (c) 2014-2020 Fabian Mink <fabian.mink@mink-ing.de>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+     list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file mkassets.c
+ * @brief Host tool: build the asset table of edyht from htdocs/
+ *
+ * Scans a directory recursively and writes one C include file with a const
+ * array per asset and the table edyht registers its routes from. Each
+ * served asset holds the complete response (status line, headers incl.
+ * Content-Length, body) so it can be sent with a single zero-copy write.
+ *
+ *  - HTML, CSS, JS and JSON are minified (conservatively, see below)
+ *  - the MIME type is derived from the file extension
+ *  - a FNV-1a hash of the body is stored as content hash and sent as
+ *    strong ETag with "Cache-Control: no-cache", so browsers revalidate
+ *    with If-None-Match and get "304 Not Modified" while unchanged
+ *  - with -z a gzip copy is added if it is at least 10% smaller
+ *  - files in parts/ are body-only fragments used by dynamic pages,
+ *    files named errNNN.* are error responses with status NNN, both are not
+ *    registered as routes
+ *  - files in tpl/ are templates served under their name without "tpl/":
+ *    each placeholder {{name}} ends a static segment and refers to a slot
+ *    (one ID per distinct name over all templates) that the application
+ *    renders at request time, see edyht_register_slot
+ *
+ * Build and run on the host (done by mkhtdocs.sh):
+ *   cc -O2 -o tools/mkassets tools/mkassets.c -lz
+ *   tools/mkassets [-z] [-n] [-r 2] htdocs edyht_assets.inc
+ *
+ *  -z  add gzip copies
+ *  -n  do not minify
+ *  -r  Retry-After (s) of the 503 response, default 2
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define SERVER   "Server: edyht - based on lwIP"
+
+typedef enum {
+	MIN_NONE,
+	MIN_HTML,
+	MIN_CSS,
+	MIN_JS,
+	MIN_JSON,
+} minify_t;
+
+static const struct {
+	const char *ext;
+	const char *mime;
+	minify_t minify;
+	const char *content;   //edyht_content_t of templates, NULL: no templates of this type
+} mimeTypes[] = {
+		{ "htm",   "text/html",              MIN_HTML, "EDYHT_CONTENT_HTML"  },
+		{ "html",  "text/html",              MIN_HTML, "EDYHT_CONTENT_HTML"  },
+		{ "css",   "text/css",               MIN_CSS,  NULL                  },
+		{ "js",    "text/javascript",        MIN_JS,   "EDYHT_CONTENT_JS"    },
+		{ "json",  "application/json",       MIN_JSON, "EDYHT_CONTENT_JSON"  },
+		{ "csv",   "text/csv",               MIN_NONE, "EDYHT_CONTENT_CSV"   },
+		{ "txt",   "text/plain",             MIN_NONE, "EDYHT_CONTENT_PLAIN" },
+		{ "png",   "image/png",              MIN_NONE, NULL                  },
+		{ "jpg",   "image/jpeg",             MIN_NONE, NULL                  },
+		{ "gif",   "image/gif",              MIN_NONE, NULL                  },
+		{ "svg",   "image/svg+xml",          MIN_NONE, NULL                  },
+		{ "ico",   "image/x-icon",           MIN_NONE, NULL                  },
+		{ "woff2", "font/woff2",             MIN_NONE, NULL                  },
+};
+#define MIME_DEFAULT "application/octet-stream"
+
+static const struct {
+	int status;
+	const char *reason;
+	int close;       //server closes the connection after this response
+} statusLines[] = {
+		{ 400, "Bad Request",           1 },
+		{ 404, "File not found",        0 },
+		{ 500, "Internal Server Error", 1 },
+		{ 501, "Not Implemented",       1 },
+		{ 503, "Service Unavailable",   1 },
+};
+
+typedef struct {
+	char *path;      //relative to the scanned directory
+	char *var;       //C identifier
+	int route;       //registered as route
+	int part;        //body only
+	int tpl;         //template
+	const char *content;
+	int status;
+	const char *mime;
+	minify_t minify;
+	unsigned long srcLen;
+	unsigned char *body;
+	unsigned long len;
+	unsigned char *gz;
+	unsigned long gzLen;
+	uint32_t hash;
+} asset_t;
+
+static asset_t *assets;
+static unsigned int nAssets;
+
+static char **slots;    //placeholder names of all templates, index is the slot ID
+static unsigned int nSlots;
+
+static void* xrealloc(void *p, size_t n){
+	p = realloc(p, n ? n : 1);
+	if(p == NULL){
+		fprintf(stderr, "mkassets: out of memory\n");
+		exit(1);
+	}
+	return p;
+}
+
+static char* xstrdup(const char *s){
+	return strcpy(xrealloc(NULL, strlen(s) + 1), s);
+}
+
+//a "/" b, without "/" if one is empty; a path that does not fit is an error
+static void pathJoin(char *dst, size_t size, const char *a, const char *b){
+	const char *sep = (*a && *b) ? "/" : "";
+	int n = snprintf(dst, size, "%s%s%s", a, sep, b);
+
+	if((n < 0) || ((size_t)n >= size)){
+		fprintf(stderr, "mkassets: %s%s%s: path too long\n", a, sep, b);
+		exit(1);
+	}
+}
+
+/* Minifiers. They only remove what is certainly not significant: comments,
+ * indentation, trailing blanks and empty lines. Line breaks are kept, so no
+ * tokens are joined. */
+
+//Copy from in to out and drop indentation, trailing blanks and empty lines
+typedef struct {
+	unsigned char *out;
+	unsigned long o;
+	unsigned long lineStart;   //output position of the current line
+} lineTrim_t;
+
+static void trimPut(lineTrim_t *t, unsigned char c){
+	if(c == '\r') return;
+	if((c == ' ') || (c == '\t')){
+		if(t->o == t->lineStart) return;  //indentation
+	}
+	else if(c == '\n'){
+		while((t->o > t->lineStart) && ((t->out[t->o-1] == ' ') || (t->out[t->o-1] == '\t'))) t->o--;
+		if(t->o == t->lineStart) return;  //empty line
+		t->out[t->o++] = c;
+		t->lineStart = t->o;
+		return;
+	}
+	t->out[t->o++] = c;
+}
+
+static void trimRaw(lineTrim_t *t, unsigned char c){
+	t->out[t->o++] = c;
+	t->lineStart = t->o;
+}
+
+static int tagAt(const unsigned char *s, unsigned long n, const char *tag){
+	unsigned long len = strlen(tag);
+	unsigned long i;
+
+	if(n <= len) return 0;
+	for(i = 0; i < len; i++){
+		if(tolower(s[i]) != tag[i]) return 0;
+	}
+	return (s[len] == '>') || isspace(s[len]);
+}
+
+//HTML: drop comments, keep <pre> and <textarea> content unchanged
+static unsigned long minifyHtml(const unsigned char *in, unsigned long n, unsigned char *out){
+	static const char *rawTags[][2] = { { "<pre", "</pre" }, { "<textarea", "</textarea" } };
+	lineTrim_t t = { out, 0, 0 };
+	const char *rawEnd = NULL;
+	unsigned long i = 0;
+	unsigned int k;
+
+	while(i < n){
+		if(rawEnd != NULL){
+			if(tagAt(&in[i], n - i, rawEnd)){
+				rawEnd = NULL;
+			}
+			else{
+				trimRaw(&t, in[i++]);
+				continue;
+			}
+		}
+		if((n - i >= 4) && (memcmp(&in[i], "<!--", 4) == 0) && !((n - i >= 5) && (in[i+4] == '['))){
+			const unsigned char *end = NULL;
+			unsigned long j;
+			for(j = i + 4; j + 3 <= n; j++){
+				if(memcmp(&in[j], "-->", 3) == 0){
+					end = &in[j+3];
+					break;
+				}
+			}
+			if(end != NULL){
+				i = end - in;
+				continue;
+			}
+		}
+		for(k = 0; k < sizeof(rawTags)/sizeof(rawTags[0]); k++){
+			if(tagAt(&in[i], n - i, rawTags[k][0])){
+				while((i < n) && (in[i] != '>')) trimPut(&t, in[i++]);
+				if(i < n) trimRaw(&t, in[i++]);
+				rawEnd = rawTags[k][1];
+				break;
+			}
+		}
+		if(rawEnd != NULL) continue;
+		trimPut(&t, in[i++]);
+	}
+	trimPut(&t, '\n');
+	if((n > 0) && (in[n-1] != '\n') && (t.o > 0) && (out[t.o-1] == '\n')) t.o--;
+	return t.o;
+}
+
+//CSS: drop /* */ comments outside strings
+static unsigned long minifyCss(const unsigned char *in, unsigned long n, unsigned char *out){
+	lineTrim_t t = { out, 0, 0 };
+	unsigned char quote = 0;
+	unsigned long i = 0;
+
+	while(i < n){
+		unsigned char c = in[i];
+		if(quote){
+			if(c == '\\' && (i + 1 < n)){
+				trimPut(&t, in[i++]);
+			}
+			else if(c == quote){
+				quote = 0;
+			}
+			trimPut(&t, in[i++]);
+			continue;
+		}
+		if((c == '"') || (c == '\'')) quote = c;
+		if((c == '/') && (i + 1 < n) && (in[i+1] == '*')){
+			for(i += 2; (i + 1 < n) && !((in[i] == '*') && (in[i+1] == '/')); i++);
+			i += 2;
+			continue;
+		}
+		trimPut(&t, in[i++]);
+	}
+	trimPut(&t, '\n');
+	if((n > 0) && (in[n-1] != '\n') && (t.o > 0) && (out[t.o-1] == '\n')) t.o--;
+	return t.o;
+}
+
+//JS: drop lines that only hold a // comment
+static unsigned long minifyJs(const unsigned char *in, unsigned long n, unsigned char *out){
+	lineTrim_t t = { out, 0, 0 };
+	unsigned long i = 0;
+
+	while(i < n){
+		if((t.o == t.lineStart) && (in[i] == '/') && (i + 1 < n) && (in[i+1] == '/')){
+			while((i < n) && (in[i] != '\n')) i++;
+			continue;
+		}
+		trimPut(&t, in[i++]);
+	}
+	trimPut(&t, '\n');
+	if((n > 0) && (in[n-1] != '\n') && (t.o > 0) && (out[t.o-1] == '\n')) t.o--;
+	return t.o;
+}
+
+//JSON: drop all white space outside strings
+static unsigned long minifyJson(const unsigned char *in, unsigned long n, unsigned char *out){
+	unsigned long i, o = 0;
+	int str = 0;
+
+	for(i = 0; i < n; i++){
+		unsigned char c = in[i];
+		if(str){
+			if((c == '\\') && (i + 1 < n)){
+				out[o++] = c;
+				c = in[++i];
+			}
+			else if(c == '"'){
+				str = 0;
+			}
+		}
+		else if(c == '"'){
+			str = 1;
+		}
+		else if(isspace(c)){
+			continue;
+		}
+		out[o++] = c;
+	}
+	return o;
+}
+
+static uint32_t fnv1a(const unsigned char *s, unsigned long n){
+	uint32_t hash = 2166136261u;
+	while(n--) hash = (hash ^ *s++) * 16777619u;
+	return hash;
+}
+
+static unsigned char* gzipBody(const unsigned char *in, unsigned long n, unsigned long *outLen){
+	z_stream z;
+	unsigned long max = deflateBound(NULL, n) + 32;
+	unsigned char *out = xrealloc(NULL, max);
+
+	memset(&z, 0, sizeof(z));
+	//windowBits 15 + 16: gzip wrapper, mtime 0 for reproducible output
+	if(deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK){
+		fprintf(stderr, "mkassets: deflateInit2 failed\n");
+		exit(1);
+	}
+	z.next_in = (unsigned char*)in;
+	z.avail_in = n;
+	z.next_out = out;
+	z.avail_out = max;
+	if(deflate(&z, Z_FINISH) != Z_STREAM_END){
+		fprintf(stderr, "mkassets: deflate failed\n");
+		exit(1);
+	}
+	*outLen = z.total_out;
+	deflateEnd(&z);
+	return out;
+}
+
+static void addFile(const char *dir, const char *rel){
+	char full[4096];
+	FILE *f;
+	unsigned char *src;
+	unsigned long n;
+	const char *base, *ext;
+	asset_t *a;
+	unsigned int k;
+
+	pathJoin(full, sizeof(full), dir, rel);
+	f = fopen(full, "rb");
+	if(f == NULL){
+		perror(full);
+		exit(1);
+	}
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	src = xrealloc(NULL, n);
+	if(fread(src, 1, n, f) != n){
+		perror(full);
+		exit(1);
+	}
+	fclose(f);
+
+	assets = xrealloc(assets, (nAssets + 1) * sizeof(asset_t));
+	a = &assets[nAssets++];
+	memset(a, 0, sizeof(*a));
+	a->path = xstrdup(rel);
+	a->tpl = (strncmp(rel, "tpl/", 4) == 0);
+	a->var = xstrdup(a->tpl ? rel + 4 : rel);
+	for(k = 0; a->var[k]; k++){
+		if(!isalnum((unsigned char)a->var[k])) a->var[k] = '_';
+	}
+	a->srcLen = n;
+	a->body = src;
+	a->len = n;
+	a->status = 200;
+	a->mime = MIME_DEFAULT;
+	a->part = (strncmp(rel, "parts/", 6) == 0);
+
+	base = strrchr(rel, '/');
+	base = base ? base + 1 : rel;
+	ext = strrchr(base, '.');
+	ext = ext ? ext + 1 : "";
+	for(k = 0; k < sizeof(mimeTypes)/sizeof(mimeTypes[0]); k++){
+		if(strcmp(ext, mimeTypes[k].ext) == 0){
+			a->mime = mimeTypes[k].mime;
+			a->minify = mimeTypes[k].minify;
+			a->content = mimeTypes[k].content;
+			break;
+		}
+	}
+	if((strncmp(base, "err", 3) == 0) && isdigit((unsigned char)base[3])){
+		a->status = atoi(&base[3]);
+	}
+	a->route = !a->part && !a->tpl && (a->status == 200);
+	if(a->tpl && (a->content == NULL)){
+		fprintf(stderr, "mkassets: %s: no template type for .%s\n", full, ext);
+		exit(1);
+	}
+}
+
+static void scanDir(const char *dir, const char *rel, const char *skip){
+	char path[4096];
+	DIR *d;
+	struct dirent *e;
+
+	pathJoin(path, sizeof(path), dir, rel);
+	d = opendir(path);
+	if(d == NULL){
+		perror(path);
+		exit(1);
+	}
+	while((e = readdir(d)) != NULL){
+		char sub[4096];
+		char full[4096];
+		struct stat st;
+		size_t len = strlen(e->d_name);
+
+		if((e->d_name[0] == '.') || (e->d_name[len-1] == '~')) continue;
+		pathJoin(sub, sizeof(sub), rel, e->d_name);
+		pathJoin(full, sizeof(full), dir, sub);
+		if((skip != NULL) && (strcmp(full, skip) == 0)) continue;
+		if(stat(full, &st) != 0) continue;
+		if(S_ISDIR(st.st_mode)) scanDir(dir, sub, skip);
+		else if(S_ISREG(st.st_mode)) addFile(dir, sub);
+	}
+	closedir(d);
+}
+
+static int assetCmp(const void *a, const void *b){
+	return strcmp(((const asset_t*)a)->path, ((const asset_t*)b)->path);
+}
+
+static void emitBytes(FILE *out, const char *hdr, unsigned long hdrLen, const unsigned char *body, unsigned long len){
+	unsigned long i, n = hdrLen + len;
+
+	for(i = 0; i < n; i++){
+		unsigned char c = (i < hdrLen) ? (unsigned char)hdr[i] : body[i - hdrLen];
+		fprintf(out, "%s0x%02x,", (i % 12) ? " " : "\n\t\t", c);
+	}
+	fprintf(out, "\n};\n");
+}
+
+static unsigned int slotId(const char *name, unsigned long len){
+	unsigned int k;
+
+	for(k = 0; k < nSlots; k++){
+		if((strlen(slots[k]) == len) && (memcmp(slots[k], name, len) == 0)) return k;
+	}
+	slots = xrealloc(slots, (nSlots + 1) * sizeof(char*));
+	slots[nSlots] = xrealloc(NULL, len + 1);
+	memcpy(slots[nSlots], name, len);
+	slots[nSlots][len] = '\0';
+	return nSlots++;
+}
+
+/* Template: static text without the placeholders and one segment per
+ * placeholder (length of the text before it, slot ID), the last segment
+ * holds the text after the last placeholder. Returns the static length. */
+static unsigned long emitTemplate(FILE *out, const asset_t *a, unsigned int *nSegs){
+	unsigned char *text = xrealloc(NULL, a->len + 1);
+	unsigned long i = 0, textLen = 0, segStart = 0;
+
+	fprintf(out, "static const tplSeg_t tplSegs_%s[] = {\n", a->var);
+	*nSegs = 0;
+	while(i < a->len){
+		unsigned long n;
+
+		if((i + 1 < a->len) && (a->body[i] == '{') && (a->body[i+1] == '{')){
+			for(n = 0; (i + 2 + n < a->len) && (isalnum(a->body[i+2+n]) || (a->body[i+2+n] == '_')
+					|| (a->body[i+2+n] == '.') || (a->body[i+2+n] == '-')); n++);
+			if((n == 0) || (i + 3 + n >= a->len) || (a->body[i+2+n] != '}') || (a->body[i+3+n] != '}')){
+				fprintf(stderr, "mkassets: %s: invalid placeholder at byte %lu\n", a->path, i);
+				exit(1);
+			}
+			fprintf(out, "\t\t{ %lu, %u },  //{{%.*s}}\n", textLen - segStart,
+					slotId((const char*)&a->body[i+2], n), (int)n, &a->body[i+2]);
+			(*nSegs)++;
+			segStart = textLen;
+			i += n + 4;
+			continue;
+		}
+		text[textLen++] = a->body[i++];
+	}
+	fprintf(out, "\t\t{ %lu, TPL_SLOT_NONE },\n};\n", textLen - segStart);
+	(*nSegs)++;
+
+	//"0" terminated, so that the array is never empty
+	text[textLen] = '\0';
+	fprintf(out, "static const unsigned char tpl_%s[] = {", a->var);
+	emitBytes(out, NULL, 0, text, textLen + 1);
+	free(text);
+	return textLen;
+}
+
+static int retryAfter = 2;  //seconds, Retry-After of 503 responses
+
+static int buildHeader(char *hdr, size_t size, const asset_t *a, unsigned long len, const char *encoding){
+	const char *reason = "OK";
+	int close = 0;
+	int n;
+	unsigned int k;
+
+	for(k = 0; k < sizeof(statusLines)/sizeof(statusLines[0]); k++){
+		if(statusLines[k].status == a->status){
+			reason = statusLines[k].reason;
+			close = statusLines[k].close;
+		}
+	}
+	n = snprintf(hdr, size, "HTTP/1.1 %d %s\r\n%s\r\nContent-Length: %lu\r\n", a->status, reason, SERVER, len);
+	if(close) n += snprintf(hdr + n, size - n, "Connection: close\r\n");
+	if(a->status == 503) n += snprintf(hdr + n, size - n, "Retry-After: %d\r\n", retryAfter);
+	if(encoding) n += snprintf(hdr + n, size - n, "Content-Encoding: %s\r\n", encoding);
+	if(a->route){
+		//must match the 304 response built by the server
+		n += snprintf(hdr + n, size - n, "ETag: \"%08x%s\"\r\n", (unsigned int)a->hash, encoding ? "-gz" : "");
+		n += snprintf(hdr + n, size - n, "Cache-Control: no-cache\r\n");
+	}
+	if(a->gz) n += snprintf(hdr + n, size - n, "Vary: Accept-Encoding\r\n");
+	n += snprintf(hdr + n, size - n, "Content-type: %s\r\n\r\n", a->mime);
+	return n;
+}
+
+int main(int argc, char **argv){
+	int gzip = 0;
+	int minify = 1;
+	int argi = 1;
+	const char *dir, *outName;
+	FILE *out;
+	unsigned int i;
+	unsigned long srcTotal = 0, total = 0;
+	unsigned int nTpl = 0;
+
+	for(; (argi < argc) && (argv[argi][0] == '-'); argi++){
+		if(strcmp(argv[argi], "-z") == 0) gzip = 1;
+		else if(strcmp(argv[argi], "-n") == 0) minify = 0;
+		else if((strcmp(argv[argi], "-r") == 0) && (argi + 1 < argc)) retryAfter = atoi(argv[++argi]);
+		else break;
+	}
+	if(argc - argi != 2){
+		fprintf(stderr, "usage: mkassets [-z] [-n] [-r <retry-after s>] <dir> <outfile>\n");
+		return 1;
+	}
+	dir = argv[argi];
+	outName = argv[argi + 1];
+
+	scanDir(dir, "", outName);
+	qsort(assets, nAssets, sizeof(asset_t), assetCmp);
+
+	out = fopen(outName, "w");
+	if(out == NULL){
+		perror(outName);
+		return 1;
+	}
+	fprintf(out, "/* Generated by mkassets from %s/ - do not edit */\n", dir);
+
+	for(i = 0; i < nAssets; i++){
+		asset_t *a = &assets[i];
+		char hdr[512];
+		int hdrLen = 0;
+
+		if(minify && (a->minify != MIN_NONE)){
+			unsigned char *min = xrealloc(NULL, a->len + 1);
+			switch(a->minify){
+			case MIN_HTML: a->len = minifyHtml(a->body, a->len, min); break;
+			case MIN_CSS:  a->len = minifyCss(a->body, a->len, min);  break;
+			case MIN_JS:   a->len = minifyJs(a->body, a->len, min);   break;
+			default:       a->len = minifyJson(a->body, a->len, min); break;
+			}
+			free(a->body);
+			a->body = min;
+		}
+		a->hash = fnv1a(a->body, a->len);
+		if(gzip && a->route){
+			a->gz = gzipBody(a->body, a->len, &a->gzLen);
+			if(a->gzLen * 10 > a->len * 9){
+				free(a->gz);
+				a->gz = NULL;
+				a->gzLen = 0;
+			}
+		}
+
+		if(a->tpl){
+			unsigned int nSegs;
+			unsigned long textLen;
+
+			fprintf(out, "\n/* %s: %lu bytes, minified %lu */\n", a->path, a->srcLen, a->len);
+			textLen = emitTemplate(out, a, &nSegs);
+			fprintf(out, "#define TPL_%s_SEGS %u\n", a->var, nSegs);
+			srcTotal += a->srcLen;
+			total += textLen + nSegs * 8;
+			nTpl++;
+			continue;
+		}
+
+		fprintf(out, "\n/* %s: %lu bytes, minified %lu", a->path, a->srcLen, a->len);
+		if(a->gz) fprintf(out, ", gzip %lu", a->gzLen);
+		fprintf(out, " */\n");
+		if(!a->part) hdrLen = buildHeader(hdr, sizeof(hdr), a, a->len, NULL);
+		fprintf(out, "static const unsigned char asset_%s[] = {", a->var);
+		emitBytes(out, hdr, hdrLen, a->body, a->len);
+		fprintf(out, "#define ASSET_%s_HDR_LEN %d\n", a->var, hdrLen);
+		srcTotal += a->srcLen;
+		total += hdrLen + a->len;
+
+		if(a->gz){
+			hdrLen = buildHeader(hdr, sizeof(hdr), a, a->gzLen, "gzip");
+			fprintf(out, "static const unsigned char asset_%s_gz[] = {", a->var);
+			emitBytes(out, hdr, hdrLen, a->gz, a->gzLen);
+			fprintf(out, "#define ASSET_%s_GZ_HDR_LEN %d\n", a->var, hdrLen);
+			total += hdrLen + a->gzLen;
+		}
+	}
+
+	fprintf(out, "\nenum {\n");
+	for(i = 0; i < nAssets; i++){
+		if(assets[i].tpl) continue;
+		fprintf(out, "\tASSET_%s,\n", assets[i].var);
+	}
+	fprintf(out, "\tASSET_COUNT\n};\n");
+
+	fprintf(out, "\nstatic const asset_t assets[ASSET_COUNT] = {\n");
+	for(i = 0; i < nAssets; i++){
+		asset_t *a = &assets[i];
+		if(a->tpl) continue;
+		fprintf(out, "\t\t[ASSET_%s] = { ", a->var);
+		if(a->route) fprintf(out, "\"%s\", ", a->path);
+		else fprintf(out, "NULL, ");
+		fprintf(out, "asset_%s, ASSET_%s_HDR_LEN, %lu, 0x%08xu, ", a->var, a->var, a->len, (unsigned int)a->hash);
+		if(a->gz) fprintf(out, "asset_%s_gz, ASSET_%s_GZ_HDR_LEN, %lu },\n", a->var, a->var, a->gzLen);
+		else fprintf(out, "NULL, 0, 0 },\n");
+	}
+	fprintf(out, "};\n");
+
+	//one more entry each, NULL terminated, so that no array is empty
+	fprintf(out, "\n#define TPL_COUNT %u\n", nTpl);
+	fprintf(out, "\nstatic const template_t templates[TPL_COUNT + 1] = {\n");
+	for(i = 0; i < nAssets; i++){
+		asset_t *a = &assets[i];
+		if(!a->tpl) continue;
+		fprintf(out, "\t\t{ \"%s\", %s, tpl_%s, tplSegs_%s, TPL_%s_SEGS },\n",
+				a->path + 4, a->content, a->var, a->var, a->var);
+	}
+	fprintf(out, "\t\t{ NULL, EDYHT_CONTENT_NONE, NULL, NULL, 0 }\n};\n");
+	fprintf(out, "\n#define TPL_SLOT_COUNT %u\n", nSlots);
+	fprintf(out, "\nstatic const char * const tplSlotNames[TPL_SLOT_COUNT + 1] = {\n");
+	for(i = 0; i < nSlots; i++){
+		fprintf(out, "\t\t\"%s\",\n", slots[i]);
+	}
+	fprintf(out, "\t\tNULL\n};\n");
+	fclose(out);
+
+	printf("mkassets: %u assets, %u templates with %u slots, %lu bytes source, %lu bytes in flash\n",
+			nAssets - nTpl, nTpl, nSlots, srcTotal, total);
+	return 0;
+}